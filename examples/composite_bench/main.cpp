@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <cpp-sdl2/compositor.hpp>
+#include <cpp-sdl2/sdl.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compare sdl::composite() against Surface::blit_on() (SDL_BlitSurface) for each blend mode
+
+namespace
+{
+constexpr int canvas_size = 1024;
+constexpr int sprite_size = 128;
+constexpr int sprites	  = 2000;
+constexpr int runs		  = 5;
+
+struct Mode
+{
+	SDL_BlendMode mode;
+	char const*	  name;
+};
+
+const Mode modes[] = {
+	{SDL_BLENDMODE_NONE, "none"},
+	{SDL_BLENDMODE_BLEND, "blend"},
+	{SDL_BLENDMODE_ADD, "add"},
+	{SDL_BLENDMODE_MOD, "mod"},
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+	{SDL_BLENDMODE_MUL, "mul"},
+#endif
+};
+
+// Run f `runs` times, return the best time in milliseconds
+template<typename F>
+double best_of(F&& f)
+{
+	auto best = std::chrono::duration<double, std::milli>::max();
+	for (int i = 0; i < runs; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		best = std::min<decltype(best)>(best, std::chrono::steady_clock::now() - start);
+	}
+	return best.count();
+}
+
+sdl::Surface random_surface(int size)
+{
+	auto surface = sdl::Surface{0, size, size, 32, SDL_PIXELFORMAT_ARGB8888};
+	auto lock	 = surface.lock();
+	auto pixels	 = static_cast<Uint8*>(lock.raw_array());
+	for (int i = 0; i < surface.ptr()->pitch * size; ++i) pixels[i] = Uint8(std::rand());
+	return surface;
+}
+
+// Largest difference between two channels of the same pixel in both surfaces
+int max_difference(sdl::Surface const& a, sdl::Surface const& b)
+{
+	int diff = 0;
+	for (int y = 0; y < a.height(); ++y)
+	{
+		auto pa = static_cast<Uint8 const*>(a.ptr()->pixels) + y * a.ptr()->pitch;
+		auto pb = static_cast<Uint8 const*>(b.ptr()->pixels) + y * b.ptr()->pitch;
+		for (int x = 0; x < a.width() * 4; ++x) diff = std::max(diff, std::abs(pa[x] - pb[x]));
+	}
+	return diff;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	auto root = sdl::Root{0};
+
+	auto sprite = random_surface(sprite_size);
+	auto canvas = random_surface(canvas_size);
+
+	// Sprites land anywhere, including partly outside of the canvas
+	std::vector<sdl::Vec2i> positions;
+	for (int i = 0; i < sprites; ++i)
+	{
+		positions.push_back(
+			{std::rand() % (canvas_size + sprite_size) - sprite_size,
+			 std::rand() % (canvas_size + sprite_size) - sprite_size});
+	}
+
+	std::cout << sprites << " sprites of " << sprite_size << "x" << sprite_size << " on "
+			  << canvas_size << "x" << canvas_size << ", best of " << runs << " runs\n\n";
+	std::cout << "mode      blit_on (ms)  composite (ms)  speedup  max diff\n";
+
+	for (auto const& m : modes)
+	{
+		sprite.set_blendmode(m.mode);
+		sprite.set_coloralphamod(220, 255, 180, 200);
+
+		auto sdl_canvas	 = canvas.with_format(canvas.format());
+		auto fast_canvas = canvas.with_format(canvas.format());
+
+		const auto sdl_ms = best_of([&] {
+			for (auto const& p : positions) sprite.blit_on(sdl_canvas, sdl::Rect{p, {0, 0}});
+		});
+		const auto fast_ms = best_of([&] {
+			for (auto const& p : positions) sdl::composite(sprite, fast_canvas, p);
+		});
+
+		std::cout.width(10);
+		std::cout << std::left << m.name << std::right;
+		std::cout.width(12);
+		std::cout << sdl_ms;
+		std::cout.width(16);
+		std::cout << fast_ms;
+		std::cout.width(9);
+		std::cout << sdl_ms / fast_ms;
+		std::cout.width(10);
+		std::cout << max_difference(sdl_canvas, fast_canvas) << "\n";
+	}
+
+	return 0;
+}
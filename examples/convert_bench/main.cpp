@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cpp-sdl2/sdl.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Compare sdl::Surface::with_format()/convert_to() fast paths against SDL's generic blitter
+
+namespace
+{
+constexpr int width	 = 4096;
+constexpr int height = 2048;
+constexpr int runs	 = 8;
+
+struct Format
+{
+	Uint32		id;
+	char const* name;
+};
+
+const Format formats[] = {
+	{SDL_PIXELFORMAT_ARGB8888, "ARGB8888"},
+	{SDL_PIXELFORMAT_ABGR8888, "ABGR8888"},
+	{SDL_PIXELFORMAT_RGBA8888, "RGBA8888"},
+	{SDL_PIXELFORMAT_RGB24, "RGB24"},
+	{SDL_PIXELFORMAT_BGR24, "BGR24"},
+};
+
+// Run f `runs` times, return the best time in milliseconds
+template<typename F>
+double best_of(F&& f)
+{
+	auto best = std::chrono::duration<double, std::milli>::max();
+	for (int i = 0; i < runs; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		best = std::min<decltype(best)>(best, std::chrono::steady_clock::now() - start);
+	}
+	return best.count();
+}
+
+sdl::Surface random_surface(Uint32 format)
+{
+	auto surface = sdl::Surface{0, width, height, int(SDL_BITSPERPIXEL(format)), format};
+	auto lock	 = surface.lock();
+	auto pixels	 = static_cast<Uint8*>(lock.raw_array());
+	for (int i = 0; i < surface.ptr()->pitch * height; ++i) pixels[i] = Uint8(std::rand());
+	return surface;
+}
+
+bool same_pixels(sdl::Surface const& a, sdl::Surface const& b)
+{
+	const auto row = size_t(width) * a.pixelformat().BytesPerPixel;
+	for (int y = 0; y < height; ++y)
+	{
+		auto pa = static_cast<Uint8 const*>(a.ptr()->pixels) + y * a.ptr()->pitch;
+		auto pb = static_cast<Uint8 const*>(b.ptr()->pixels) + y * b.ptr()->pitch;
+		if (std::memcmp(pa, pb, row) != 0) return false;
+	}
+	return true;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	auto root = sdl::Root{0};
+
+	const double mpix = double(width) * height / 1e6;
+	std::cout << width << "x" << height << " pixels, best of " << runs << " runs, in Mpixel/s\n\n";
+	std::cout << "from      to           SDL  with_format  convert_to\n";
+
+	for (auto const& from : formats)
+	{
+		for (auto const& to : formats)
+		{
+			if (from.id == to.id) continue;
+
+			auto source = random_surface(from.id);
+
+			const auto sdl_ms = best_of([&] {
+				SDL_FreeSurface(SDL_ConvertSurfaceFormat(source.ptr(), to.id, 0));
+			});
+			const auto fast_ms = best_of([&] { source.with_format(to.id); });
+
+			// In place conversion only happens between formats of the same size
+			auto in_place_ms = 0.0;
+			if (SDL_BYTESPERPIXEL(from.id) == SDL_BYTESPERPIXEL(to.id))
+			{
+				in_place_ms = best_of([&] {
+					source.convert_to(to.id);
+					source.convert_to(from.id);
+				}) / 2;
+			}
+
+			auto reference = sdl::Surface{SDL_ConvertSurfaceFormat(source.ptr(), to.id, 0)};
+			const bool ok  = same_pixels(reference, source.with_format(to.id));
+
+			std::cout.width(10);
+			std::cout << std::left << from.name;
+			std::cout.width(10);
+			std::cout << to.name << std::right;
+			std::cout.width(6);
+			std::cout << int(mpix / sdl_ms * 1000);
+			std::cout.width(13);
+			std::cout << int(mpix / fast_ms * 1000);
+			std::cout.width(12);
+			if (in_place_ms > 0)
+				std::cout << int(mpix / in_place_ms * 1000);
+			else
+				std::cout << "-";
+			std::cout << (ok ? "" : "  MISMATCH") << "\n";
+		}
+	}
+
+	return 0;
+}
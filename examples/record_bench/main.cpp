@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cpp-sdl2/sdl.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compare sdl::convert_to_i420() against SDL_ConvertPixels() to IYUV, then measure the time a
+// sdl::VideoRecorder takes from the calling thread while streaming frames to a .y4m file
+
+namespace
+{
+constexpr int width	 = 1920;
+constexpr int height = 1080;
+constexpr int runs	 = 16;
+constexpr int frames = 300;
+
+struct Format
+{
+	Uint32		id;
+	char const* name;
+};
+
+const Format formats[] = {
+	{SDL_PIXELFORMAT_ARGB8888, "ARGB8888"},
+	{SDL_PIXELFORMAT_ABGR8888, "ABGR8888"},
+	{SDL_PIXELFORMAT_RGB24, "RGB24"},
+};
+
+// Run f `runs` times, return the best time in milliseconds
+template<typename F>
+double best_of(F&& f)
+{
+	auto best = std::chrono::duration<double, std::milli>::max();
+	for (int i = 0; i < runs; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		best = std::min<decltype(best)>(best, std::chrono::steady_clock::now() - start);
+	}
+	return best.count();
+}
+
+sdl::Surface random_surface(Uint32 format)
+{
+	auto surface = sdl::Surface{0, width, height, int(SDL_BITSPERPIXEL(format)), format};
+	auto lock	 = surface.lock();
+	auto pixels	 = static_cast<Uint8*>(lock.raw_array());
+	for (int i = 0; i < surface.ptr()->pitch * height; ++i) pixels[i] = Uint8(std::rand());
+	return surface;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	auto root = sdl::Root{0};
+
+	std::cout << width << "x" << height << " frames, best of " << runs << " runs, in ms\n\n";
+	std::cout << "from        SDL  convert_to_i420\n";
+
+	std::vector<Uint8> iyuv(size_t(width) * height * 3 / 2);
+	sdl::I420Image	   image;
+	for (auto const& format : formats)
+	{
+		auto src = random_surface(format.id);
+		auto s	 = src.ptr();
+
+		const auto sdl_ms = best_of([&] {
+			SDL_ConvertPixels(
+				width,
+				height,
+				format.id,
+				s->pixels,
+				s->pitch,
+				SDL_PIXELFORMAT_IYUV,
+				iyuv.data(),
+				width);
+		});
+		const auto ours_ms = best_of([&] { image.assign(src); });
+
+		std::cout.width(8);
+		std::cout << std::left << format.name << "  ";
+		std::cout.width(6);
+		std::cout << std::right << sdl_ms << "  ";
+		std::cout.width(15);
+		std::cout << ours_ms << "\n";
+	}
+
+	// Streaming: the calling thread only converts, the writer thread does the disk I/O
+	auto frame = random_surface(SDL_PIXELFORMAT_ARGB8888);
+	auto total = std::chrono::duration<double, std::milli>::zero();
+	{
+		sdl::VideoRecorder recorder{sdl::Y4mWriter{"record_bench.y4m", 60}};
+		for (int i = 0; i < frames; ++i)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			recorder.record(frame);
+			total += std::chrono::steady_clock::now() - start;
+		}
+		recorder.flush();
+		std::cout << "\nrecorded " << recorder.recorded() << " frames to record_bench.y4m, "
+				  << total.count() / frames << " ms per frame on the calling thread\n";
+	}
+
+	return 0;
+}
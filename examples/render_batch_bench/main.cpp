@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <chrono>
+#include <cpp-sdl2/render_batch.hpp>
+#include <cpp-sdl2/sdl.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compare drawing many small colored rects directly with the Renderer, and through a RenderBatch
+
+namespace
+{
+constexpr int width	 = 1280;
+constexpr int height = 720;
+constexpr int draws	 = 20000;
+constexpr int frames = 60;
+
+struct Draw
+{
+	sdl::Rect  rect;
+	sdl::Color color;
+	bool	   outline;
+};
+
+// Run f once per frame, presenting after each, return the mean frame time in milliseconds
+template<typename F>
+double per_frame(sdl::Renderer const& renderer, F&& f)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames; ++i)
+	{
+		renderer.clear(sdl::Color::Black());
+		f();
+		renderer.present();
+	}
+	const auto total = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration<double, std::milli>{total}.count() / frames;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+	(void)argc;
+	(void)argv;
+
+	auto root	  = sdl::Root{SDL_INIT_VIDEO};
+	auto window	  = sdl::Window{"render_batch_bench", {width, height}};
+	auto renderer = window.make_renderer();
+
+	// Small widgets, a few colors, like a busy UI
+	std::vector<Draw> scene;
+	for (int i = 0; i < draws; ++i)
+	{
+		const auto rect = sdl::Rect{
+			std::rand() % width, std::rand() % height, 4 + std::rand() % 24, 4 + std::rand() % 12};
+		const auto color
+			= sdl::Color{Uint8(std::rand() % 4 * 80), Uint8(std::rand() % 4 * 80), 160};
+		scene.push_back({rect, color, std::rand() % 4 == 0});
+	}
+
+	const auto direct_ms = per_frame(renderer, [&] {
+		for (auto const& d : scene)
+		{
+			if (d.outline)
+				renderer.draw_rect(d.rect, d.color);
+			else
+				renderer.fill_rect(d.rect, d.color);
+		}
+	});
+
+	auto   batch  = sdl::RenderBatch{renderer};
+	size_t groups = 0;
+	const auto batch_ms = per_frame(renderer, [&] {
+		for (auto const& d : scene)
+		{
+			if (d.outline)
+				batch.draw_rect(d.rect, d.color);
+			else
+				batch.fill_rect(d.rect, d.color);
+		}
+		groups = batch.groups();
+		batch.flush();
+	});
+
+	std::cout << draws << " rects per frame, mean of " << frames << " frames, renderer "
+			  << renderer.info().name << "\n\n";
+	std::cout << "direct:  " << direct_ms << " ms/frame\n";
+	std::cout << "batched: " << batch_ms << " ms/frame, " << groups << " groups\n";
+	std::cout << "speedup: " << direct_ms / batch_ms << "\n";
+
+	return 0;
+}
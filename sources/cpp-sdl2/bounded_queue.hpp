@@ -0,0 +1,125 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace sdl
+{
+///\brief Thread safe FIFO queue holding at most a fixed number of items.
+///
+///Producers choose between blocking while the queue is full with push(), or giving up with
+///try_push(). Once close() is called, nothing more can be pushed, and pop() returns false when the
+///items left are consumed.
+template<typename T>
+class BoundedQueue
+{
+public:
+	///Create a queue holding at most capacity items
+	explicit BoundedQueue(size_t capacity) : capacity_{capacity > 0 ? capacity : 1} {}
+
+	///This object is shared between threads, it is not copyable
+	BoundedQueue(BoundedQueue const&) = delete;
+	///This object is shared between threads, it is not copyable
+	BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+	///Add an item if there is room for it, without waiting. The item is only moved from when this
+	///returns true
+	bool try_push(T&& item)
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			if (closed_ || items_.size() >= capacity_) return false;
+			items_.push_back(std::move(item));
+		}
+		not_empty_.notify_one();
+		return true;
+	}
+
+	///Add an item, waiting for room if the queue is full. Return false if the queue is closed
+	bool push(T&& item)
+	{
+		{
+			std::unique_lock<std::mutex> lock{mutex_};
+			not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+			if (closed_) return false;
+			items_.push_back(std::move(item));
+		}
+		not_empty_.notify_one();
+		return true;
+	}
+
+	///Take the oldest item, waiting for one if the queue is empty. Return false once the queue is
+	///closed and empty
+	bool pop(T& item)
+	{
+		{
+			std::unique_lock<std::mutex> lock{mutex_};
+			not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+			if (items_.empty()) return false;
+			item = std::move(items_.front());
+			items_.pop_front();
+		}
+		not_full_.notify_one();
+		return true;
+	}
+
+	///Take the oldest item if there is one, without waiting
+	bool try_pop(T& item)
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			if (items_.empty()) return false;
+			item = std::move(items_.front());
+			items_.pop_front();
+		}
+		not_full_.notify_one();
+		return true;
+	}
+
+	///Refuse new items, and wake every waiting thread. Items already queued can still be popped
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			closed_ = true;
+		}
+		not_empty_.notify_all();
+		not_full_.notify_all();
+	}
+
+	///Return true if close() was called
+	bool closed() const
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		return closed_;
+	}
+
+	///Get the number of items queued
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		return items_.size();
+	}
+
+	///Get the maximum number of items queued
+	size_t capacity() const { return capacity_; }
+
+private:
+	///Protect items_ and closed_
+	mutable std::mutex mutex_;
+	///Signaled when an item is added, or the queue is closed
+	std::condition_variable not_empty_;
+	///Signaled when an item is removed, or the queue is closed
+	std::condition_variable not_full_;
+	///Queued items, oldest first
+	std::deque<T> items_;
+	///Maximum number of items
+	size_t capacity_;
+	///True once close() was called
+	bool closed_ = false;
+};
+
+} // namespace sdl
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "exception.hpp"
+#include "pixel_format.hpp"
 #include <SDL_pixels.h>
 #include <ostream>
 
@@ -36,13 +37,7 @@ public:
 	}
 
 	/// \copydoc Color(Uint32 raw, SDL_PixelFormat const& format)
-	Color(Uint32 raw, Uint32 format)
-	{
-		auto f = SDL_AllocFormat(format);
-		if (!f) throw Exception{"SDL_AllocFormat"};
-		SDL_GetRGBA(raw, f, &r, &g, &b, &a);
-		SDL_FreeFormat(f);
-	}
+	Color(Uint32 raw, Uint32 format) : Color{raw, PixelFormat::get(format)} {}
 
 	///Default copy assing operator
 	Color& operator=(Color const&) = default;
@@ -65,14 +60,7 @@ public:
 	}
 
 	/// \copydoc as_uint(SDL_PixelFormat const& format) const
-	Uint32 as_uint(Uint32 format) const
-	{
-		auto f = SDL_AllocFormat(format);
-		if (!f) throw Exception{"SDL_AllocFormat"};
-		auto raw = as_uint(*f);
-		SDL_FreeFormat(f);
-		return raw;
-	}
+	Uint32 as_uint(Uint32 format) const { return as_uint(PixelFormat::get(format)); }
 
 	/// Return true if both colors are identical
 	bool operator==(Color const& c) const
@@ -0,0 +1,481 @@
+#pragma once
+
+#include "exception.hpp"
+#include "pixel_convert.hpp"
+#include "rect.hpp"
+#include "surface.hpp"
+#include "system.hpp"
+#include "vec2.hpp"
+
+#include <SDL_blendmode.h>
+#include <SDL_surface.h>
+#include <SDL_version.h>
+
+#ifdef CPP_SDL2_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace sdl
+{
+///How the color channels of a source surface relate to its alpha channel
+enum class AlphaMode
+{
+	///Color is independent from alpha, as SDL expects it
+	straight,
+	///Color is already multiplied by alpha
+	premultiplied,
+};
+
+namespace details
+{
+///Blend operation of a composite, one per SDL_BlendMode surfaces accept
+enum class CompositeOp
+{
+	none,
+	blend,
+	add,
+	mod,
+	mul,
+};
+
+///Divide by 255, rounded to nearest, for x <= 255 * 255
+constexpr Uint32 div255(Uint32 x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+///\brief Per-composite constants, for 32 bit pixels where src and dst share their byte layout.
+///
+///Sources are premultiplied (if needed) after color and alpha modulation, then blended with:
+/// - none: dst = src
+/// - blend: dst = src + dst * (1 - srcA), alpha included
+/// - add: dstRGB = srcRGB + dstRGB
+/// - mod: dstRGB = srcRGB * dstRGB
+/// - mul: dstRGB = srcRGB * dstRGB + dstRGB * (1 - srcA)
+///Like SDL, mod and mul use the straight source color, and keep the destination alpha.
+struct CompositeParams
+{
+	///Multiplier applied to each byte of a source pixel
+	std::array<Uint8, 4> mod = {{255, 255, 255, 255}};
+	///Byte holding alpha (or padding) in both pixels
+	int alpha = 3;
+	///Or-ed into the source alpha byte, 0xFF when the source has no alpha
+	Uint8 src_fill = 0;
+	///Leave the destination alpha byte alone, when the destination has no alpha
+	bool keep_dst_alpha = false;
+
+	///Modulation for 2 pixels in 16 bit lanes
+	alignas(16) std::array<Uint16, 8> simd_mod = {};
+	///pshufb control copying the alpha lane of 2 pixels to their other lanes
+	alignas(16) std::array<Uint8, 16> simd_alpha = {};
+	///0xFFFF on the alpha lanes of 2 pixels
+	alignas(16) std::array<Uint16, 8> simd_alpha_mask = {};
+	///Alpha lanes if keep_dst_alpha, nothing otherwise
+	alignas(16) std::array<Uint16, 8> simd_keep = {};
+	///src_fill in place for 4 pixels
+	alignas(16) std::array<Uint8, 16> simd_fill = {};
+
+	///Fill the SIMD constants from the others
+	void prepare()
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			simd_mod[i]		   = mod[i % 4];
+			simd_alpha_mask[i] = i % 4 == alpha ? 0xFFFF : 0;
+			simd_keep[i]	   = keep_dst_alpha ? simd_alpha_mask[i] : 0;
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			simd_alpha[i] = Uint8((i / 8) * 8 + 2 * alpha + i % 2);
+			simd_fill[i]  = i % 4 == alpha ? src_fill : 0;
+		}
+	}
+};
+
+///Composite pixels [x, width) of a row, one at a time
+template<CompositeOp Op, bool Premultiply>
+void composite_row_scalar(CompositeParams const& p, Uint8 const* src, Uint8* dst, int x, int width)
+{
+	for (; x < width; ++x)
+	{
+		auto s = src + 4 * x;
+		auto d = dst + 4 * x;
+
+		Uint32 sp[4];
+		for (int c = 0; c < 4; ++c)
+			sp[c] = div255(Uint32(c == p.alpha ? s[c] | p.src_fill : s[c]) * p.mod[c]);
+		const Uint32 sa = sp[p.alpha];
+
+		for (int c = 0; c < 4; ++c)
+		{
+			const bool	 is_alpha = c == p.alpha;
+			const Uint32 dc		  = d[c];
+			Uint32		 sc		  = sp[c];
+			Uint32		 r		  = sc;
+
+			if (Premultiply && (Op == CompositeOp::blend || Op == CompositeOp::add) && !is_alpha)
+				sc = div255(sc * sa);
+
+			switch (Op)
+			{
+			case CompositeOp::none: r = sc; break;
+			case CompositeOp::blend: r = std::min<Uint32>(255, sc + div255(dc * (255 - sa))); break;
+			case CompositeOp::add: r = is_alpha ? dc : std::min<Uint32>(255, sc + dc); break;
+			case CompositeOp::mod: r = is_alpha ? dc : div255(sc * dc); break;
+			case CompositeOp::mul:
+				r = std::min<Uint32>(255, div255(sc * dc) + div255(dc * (255 - sa)));
+				r = is_alpha ? dc : r;
+				break;
+			}
+
+			d[c] = Uint8(is_alpha && p.keep_dst_alpha ? dc : r);
+		}
+	}
+}
+
+#ifdef CPP_SDL2_X86_DISPATCH
+///Divide 16 bit lanes by 255, rounded to nearest
+CPP_SDL2_TARGET("sse4.1")
+inline __m128i div255_sse41(__m128i x)
+{
+	x = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+///Composite 2 pixels held in 16 bit lanes
+template<CompositeOp Op, bool Premultiply>
+CPP_SDL2_TARGET("sse4.1")
+inline __m128i composite_sse41(
+	__m128i s, __m128i d, __m128i mod, __m128i alpha, __m128i alpha_mask, __m128i keep)
+{
+	const auto c255 = _mm_set1_epi16(255);
+
+	s			  = div255_sse41(_mm_mullo_epi16(s, mod));
+	const auto sa = _mm_shuffle_epi8(s, alpha);
+	if (Premultiply && (Op == CompositeOp::blend || Op == CompositeOp::add))
+		s = div255_sse41(_mm_mullo_epi16(s, _mm_blendv_epi8(sa, c255, alpha_mask)));
+
+	// Results above 255 saturate when packed back to bytes
+	auto r = s;
+	switch (Op)
+	{
+	case CompositeOp::none: break;
+	case CompositeOp::blend:
+		r = _mm_add_epi16(s, div255_sse41(_mm_mullo_epi16(d, _mm_sub_epi16(c255, sa))));
+		break;
+	case CompositeOp::add: r = _mm_blendv_epi8(_mm_add_epi16(s, d), d, alpha_mask); break;
+	case CompositeOp::mod:
+		r = _mm_blendv_epi8(div255_sse41(_mm_mullo_epi16(s, d)), d, alpha_mask);
+		break;
+	case CompositeOp::mul:
+		r = _mm_add_epi16(
+			div255_sse41(_mm_mullo_epi16(s, d)),
+			div255_sse41(_mm_mullo_epi16(d, _mm_sub_epi16(c255, sa))));
+		r = _mm_blendv_epi8(r, d, alpha_mask);
+		break;
+	}
+
+	return _mm_blendv_epi8(r, d, keep);
+}
+
+///Composite the start of a row 4 pixels at a time. Return the number of pixels done
+template<CompositeOp Op, bool Premultiply>
+CPP_SDL2_TARGET("sse4.1")
+inline int composite_row_sse41(CompositeParams const& p, Uint8 const* src, Uint8* dst, int width)
+{
+	auto ptr = [](auto const& a) { return reinterpret_cast<__m128i const*>(a.data()); };
+
+	const auto mod		  = _mm_load_si128(ptr(p.simd_mod));
+	const auto alpha	  = _mm_load_si128(ptr(p.simd_alpha));
+	const auto alpha_mask = _mm_load_si128(ptr(p.simd_alpha_mask));
+	const auto keep		  = _mm_load_si128(ptr(p.simd_keep));
+	const auto fill		  = _mm_load_si128(ptr(p.simd_fill));
+	const auto zero		  = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		auto	   s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + 4 * x));
+		const auto d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst + 4 * x));
+		s			 = _mm_or_si128(s, fill);
+
+		const auto lo = composite_sse41<Op, Premultiply>(
+			_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), mod, alpha, alpha_mask, keep);
+		const auto hi = composite_sse41<Op, Premultiply>(
+			_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), mod, alpha, alpha_mask, keep);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x), _mm_packus_epi16(lo, hi));
+	}
+	return x;
+}
+
+///Divide 16 bit lanes by 255, rounded to nearest
+CPP_SDL2_TARGET("avx2")
+inline __m256i div255_avx2(__m256i x)
+{
+	x = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+}
+
+///Composite 4 pixels held in 16 bit lanes, 2 per 128 bit lane
+template<CompositeOp Op, bool Premultiply>
+CPP_SDL2_TARGET("avx2")
+inline __m256i composite_avx2(
+	__m256i s, __m256i d, __m256i mod, __m256i alpha, __m256i alpha_mask, __m256i keep)
+{
+	const auto c255 = _mm256_set1_epi16(255);
+
+	s			  = div255_avx2(_mm256_mullo_epi16(s, mod));
+	const auto sa = _mm256_shuffle_epi8(s, alpha);
+	if (Premultiply && (Op == CompositeOp::blend || Op == CompositeOp::add))
+		s = div255_avx2(_mm256_mullo_epi16(s, _mm256_blendv_epi8(sa, c255, alpha_mask)));
+
+	// Results above 255 saturate when packed back to bytes
+	auto r = s;
+	switch (Op)
+	{
+	case CompositeOp::none: break;
+	case CompositeOp::blend:
+		r = _mm256_add_epi16(s, div255_avx2(_mm256_mullo_epi16(d, _mm256_sub_epi16(c255, sa))));
+		break;
+	case CompositeOp::add: r = _mm256_blendv_epi8(_mm256_add_epi16(s, d), d, alpha_mask); break;
+	case CompositeOp::mod:
+		r = _mm256_blendv_epi8(div255_avx2(_mm256_mullo_epi16(s, d)), d, alpha_mask);
+		break;
+	case CompositeOp::mul:
+		r = _mm256_add_epi16(
+			div255_avx2(_mm256_mullo_epi16(s, d)),
+			div255_avx2(_mm256_mullo_epi16(d, _mm256_sub_epi16(c255, sa))));
+		r = _mm256_blendv_epi8(r, d, alpha_mask);
+		break;
+	}
+
+	return _mm256_blendv_epi8(r, d, keep);
+}
+
+///Composite the start of a row 8 pixels at a time. Return the number of pixels done
+template<CompositeOp Op, bool Premultiply>
+CPP_SDL2_TARGET("avx2")
+inline int composite_row_avx2(CompositeParams const& p, Uint8 const* src, Uint8* dst, int width)
+{
+	auto ptr = [](auto const& a) { return reinterpret_cast<__m128i const*>(a.data()); };
+
+	const auto mod		  = _mm256_broadcastsi128_si256(_mm_load_si128(ptr(p.simd_mod)));
+	const auto alpha	  = _mm256_broadcastsi128_si256(_mm_load_si128(ptr(p.simd_alpha)));
+	const auto alpha_mask = _mm256_broadcastsi128_si256(_mm_load_si128(ptr(p.simd_alpha_mask)));
+	const auto keep		  = _mm256_broadcastsi128_si256(_mm_load_si128(ptr(p.simd_keep)));
+	const auto fill		  = _mm256_broadcastsi128_si256(_mm_load_si128(ptr(p.simd_fill)));
+	const auto zero		  = _mm256_setzero_si256();
+
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		auto	   s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + 4 * x));
+		const auto d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + 4 * x));
+		s			 = _mm256_or_si256(s, fill);
+
+		const auto lo = composite_avx2<Op, Premultiply>(
+			_mm256_unpacklo_epi8(s, zero),
+			_mm256_unpacklo_epi8(d, zero),
+			mod,
+			alpha,
+			alpha_mask,
+			keep);
+		const auto hi = composite_avx2<Op, Premultiply>(
+			_mm256_unpackhi_epi8(s, zero),
+			_mm256_unpackhi_epi8(d, zero),
+			mod,
+			alpha,
+			alpha_mask,
+			keep);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4 * x), _mm256_packus_epi16(lo, hi));
+	}
+	return x;
+}
+#endif
+
+///Composite rows of pixels with the kernel matching the running CPU
+template<CompositeOp Op, bool Premultiply>
+void composite_rows(
+	CompositeParams const& p,
+	Uint8 const*		   src,
+	int					   src_pitch,
+	Uint8*				   dst,
+	int					   dst_pitch,
+	int					   width,
+	int					   height)
+{
+	for (int y = 0; y < height; ++y, src += src_pitch, dst += dst_pitch)
+	{
+		int x = 0;
+#ifdef CPP_SDL2_X86_DISPATCH
+		switch (simd_level())
+		{
+		case SimdLevel::avx2: x = composite_row_avx2<Op, Premultiply>(p, src, dst, width); break;
+		case SimdLevel::sse41: x = composite_row_sse41<Op, Premultiply>(p, src, dst, width); break;
+		case SimdLevel::scalar: break;
+		}
+#endif
+		composite_row_scalar<Op, Premultiply>(p, src, dst, x, width);
+	}
+}
+
+///\brief Composite src onto dst with the SIMD kernels.
+///
+///Return false, without touching anything, if the surfaces or the blend mode aren't handled.
+inline bool composite_fast(
+	Surface const& src,
+	SDL_Rect const* src_rect,
+	Surface&		dst,
+	Vec2i			dst_pos,
+	AlphaMode		mode)
+{
+	auto s = src.ptr();
+	auto d = dst.ptr();
+
+	const auto sl = byte_layout(s->format->format);
+	const auto dl = byte_layout(d->format->format);
+	if (sl.bytes != 4 || dl.bytes != 4) return false;
+	if (sl.r != dl.r || sl.g != dl.g || sl.b != dl.b) return false;
+	if (SDL_MUSTLOCK(s) || SDL_MUSTLOCK(d) || surfaces_overlap(s, d)) return false;
+
+	Uint32 key;
+	if (SDL_GetColorKey(s, &key) == 0) return false;
+
+	CompositeOp op;
+	switch (src.blendmode())
+	{
+	case SDL_BLENDMODE_NONE: op = CompositeOp::none; break;
+	case SDL_BLENDMODE_BLEND: op = CompositeOp::blend; break;
+	case SDL_BLENDMODE_ADD: op = CompositeOp::add; break;
+	case SDL_BLENDMODE_MOD: op = CompositeOp::mod; break;
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+	case SDL_BLENDMODE_MUL: op = CompositeOp::mul; break;
+#endif
+	default: return false;
+	}
+
+	Rect  area;
+	Vec2i pos;
+	if (!clip_blit(s, src_rect, d, dst_pos, area, pos)) return true;
+
+	const auto cm = src.colormod();
+	const auto am = src.alphamod();
+
+	CompositeParams p;
+	p.alpha			 = 6 - sl.r - sl.g - sl.b;
+	p.src_fill		 = sl.a < 0 ? 0xFF : 0;
+	p.keep_dst_alpha = dl.a < 0;
+	p.mod[sl.r]		 = cm.r;
+	p.mod[sl.g]		 = cm.g;
+	p.mod[sl.b]		 = cm.b;
+	p.mod[p.alpha]	 = am;
+
+	// Premultiplied colors scale with alpha modulation too
+	const bool premultiply = mode == AlphaMode::straight;
+	if (!premultiply)
+		for (int c = 0; c < 4; ++c)
+			if (c != p.alpha) p.mod[c] = Uint8(div255(Uint32(p.mod[c]) * am));
+	p.prepare();
+
+	auto sp = static_cast<Uint8 const*>(s->pixels) + std::ptrdiff_t(area.y) * s->pitch + area.x * 4;
+	auto dp = static_cast<Uint8*>(d->pixels) + std::ptrdiff_t(pos.y) * d->pitch + pos.x * 4;
+
+	auto run = [&](auto kernel) { kernel(p, sp, s->pitch, dp, d->pitch, area.w, area.h); };
+	switch (op)
+	{
+	case CompositeOp::none: run(composite_rows<CompositeOp::none, false>); break;
+	case CompositeOp::blend:
+		premultiply ? run(composite_rows<CompositeOp::blend, true>)
+					: run(composite_rows<CompositeOp::blend, false>);
+		break;
+	case CompositeOp::add:
+		premultiply ? run(composite_rows<CompositeOp::add, true>)
+					: run(composite_rows<CompositeOp::add, false>);
+		break;
+	case CompositeOp::mod: run(composite_rows<CompositeOp::mod, false>); break;
+	case CompositeOp::mul: run(composite_rows<CompositeOp::mul, false>); break;
+	}
+	return true;
+}
+} // namespace details
+
+///\brief Alpha-blend a surface onto another, like Surface::blit_on(), with SIMD kernels.
+///
+///The blend mode, color mod and alpha mod of src are honoured, and clipping follows
+///SDL_BlitSurface(). The kernels handle 32 bit surfaces whose color channels sit at the same place
+///(e.g. ARGB8888 or RGB888 onto ARGB8888) without a color key. Other cases go through
+///SDL_BlitSurface(), which only understands straight alpha: compositing a premultiplied source
+///that needs it throws.
+///\param src_rect area of src to draw, or nullptr for all of it
+///\param dst_pos where the area lands on dst
+inline void composite(
+	Surface const&	src,
+	SDL_Rect const* src_rect,
+	Surface&		dst,
+	Vec2i			dst_pos,
+	AlphaMode		mode = AlphaMode::straight)
+{
+	if (details::composite_fast(src, src_rect, dst, dst_pos, mode)) return;
+
+	if (mode == AlphaMode::premultiplied)
+	{
+		SDL_SetError(
+			"composite: premultiplied %s source onto %s destination is not supported",
+			SDL_GetPixelFormatName(src.format()),
+			SDL_GetPixelFormatName(dst.format()));
+		throw Exception{"composite"};
+	}
+
+	auto dstrect = Rect{dst_pos, {0, 0}};
+	if (SDL_BlitSurface(src.ptr(), src_rect, dst.ptr(), &dstrect) != 0)
+		throw Exception{"SDL_BlitSurface"};
+}
+
+///Alpha-blend an area of a surface onto another. See composite()
+inline void composite(
+	Surface const& src,
+	Rect const&	   src_rect,
+	Surface&	   dst,
+	Vec2i		   dst_pos,
+	AlphaMode	   mode = AlphaMode::straight)
+{
+	composite(src, &src_rect, dst, dst_pos, mode);
+}
+
+///Alpha-blend a whole surface onto another. See composite()
+inline void composite(
+	Surface const& src, Surface& dst, Vec2i dst_pos, AlphaMode mode = AlphaMode::straight)
+{
+	composite(src, nullptr, dst, dst_pos, mode);
+}
+
+///\brief Multiply the color channels of a surface by its alpha channel, in place.
+///
+///Surfaces without a fast path in convert_pixels(), or without alpha, are left untouched.
+inline void premultiply_alpha(Surface& surface)
+{
+	const auto l = details::byte_layout(surface.format());
+	if (l.bytes != 4 || l.a < 0) return;
+
+	auto lock = surface.lock();
+	auto row  = static_cast<Uint8*>(lock.raw_array());
+	for (int y = 0; y < surface.height(); ++y, row += surface.ptr()->pitch)
+	{
+		for (auto p = row; p != row + 4 * surface.width(); p += 4)
+		{
+			const Uint32 a = p[l.a];
+			p[l.r]		   = Uint8(details::div255(p[l.r] * a));
+			p[l.g]		   = Uint8(details::div255(p[l.g] * a));
+			p[l.b]		   = Uint8(details::div255(p[l.b] * a));
+		}
+	}
+}
+
+} // namespace sdl
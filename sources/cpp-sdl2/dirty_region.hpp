@@ -0,0 +1,164 @@
+#pragma once
+
+#include "rect.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace sdl
+{
+///\brief Set of rectangles that changed inside a fixed area, kept small by merging them.
+///
+///Rects are clipped to the bounds. A rect that overlaps or touches another one is merged with it
+///when their union doesn't cover more pixels than both did, and when there are more than
+///max_rects() rects, the two rects whose union wastes the fewest pixels are merged.
+class DirtyRegion
+{
+public:
+	///Create an empty region covering bounds
+	explicit DirtyRegion(Rect const& bounds = {}, size_t max_rects = 16)
+		: bounds_{bounds}, max_rects_{std::max<size_t>(max_rects, 1)}
+	{
+	}
+
+	///Get the area the region is clipped to
+	Rect const& bounds() const { return bounds_; }
+	///Change the area the region is clipped to. Clears the region
+	void set_bounds(Rect const& bounds)
+	{
+		bounds_ = bounds;
+		clear();
+	}
+
+	///Get the maximum number of rects kept
+	size_t max_rects() const { return max_rects_; }
+
+	///Get the dirty rects. They don't overlap each other, but may touch
+	std::vector<Rect> const& rects() const { return rects_; }
+	///Return true if nothing is dirty
+	bool empty() const { return rects_.empty(); }
+	///Get the number of dirty pixels
+	long long area() const
+	{
+		long long a = 0;
+		for (auto const& r : rects_) a += area(r);
+		return a;
+	}
+
+	///Forget every dirty rect
+	void clear() { rects_.clear(); }
+
+	///Mark the whole bounds dirty
+	void add_all()
+	{
+		rects_.clear();
+		if (!bounds_.is_empty()) rects_.push_back(bounds_);
+	}
+
+	///Mark a rect dirty
+	void add(Rect const& rect)
+	{
+		auto r = bounds_.inter(rect);
+		if (r.is_empty()) return;
+
+		for (auto const& e : rects_)
+			if (contains(e, r)) return;
+
+		// Absorb every rect that can be merged for free, until nothing changes
+		for (bool merged = true; merged;)
+		{
+			merged = false;
+			for (size_t i = 0; i < rects_.size(); ++i)
+			{
+				auto const& e	 = rects_[i];
+				auto		u	 = r.get_union(e);
+				const bool	free = area(u) <= area(r) + area(e) - overlap(r, e);
+				if (contains(r, e) || (touches(r, e) && free))
+				{
+					r = u;
+					rects_.erase(rects_.begin() + std::ptrdiff_t(i));
+					merged = true;
+					break;
+				}
+			}
+		}
+
+		// A merged rect may now overlap rects it couldn't absorb. Keep them disjoint
+		for (size_t i = 0; i < rects_.size();)
+		{
+			if (rects_[i].intersects(r))
+			{
+				r = r.get_union(rects_[i]);
+				rects_.erase(rects_.begin() + std::ptrdiff_t(i));
+				i = 0;
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		rects_.push_back(r);
+		if (rects_.size() > max_rects_) merge_cheapest();
+	}
+
+private:
+	///Number of pixels in a rect
+	static long long area(Rect const& r) { return r.is_empty() ? 0 : (long long)r.w * r.h; }
+
+	///Number of pixels shared by two rects
+	static long long overlap(Rect const& a, Rect const& b)
+	{
+		return a.intersects(b) ? area(a.inter(b)) : 0;
+	}
+
+	///Return true if outer contains all of inner
+	static bool contains(Rect const& outer, Rect const& inner)
+	{
+		return inner.x1() >= outer.x1() && inner.x2() <= outer.x2() && inner.y1() >= outer.y1()
+			   && inner.y2() <= outer.y2();
+	}
+
+	///Return true if two rects overlap or share an edge
+	static bool touches(Rect const& a, Rect const& b)
+	{
+		return a.x1() <= b.x2() && a.x2() >= b.x1() && a.y1() <= b.y2() && a.y2() >= b.y1();
+	}
+
+	///Merge the two rects whose union adds the fewest pixels, and whatever that union then overlaps
+	void merge_cheapest()
+	{
+		size_t	  best_i = 0, best_j = 1;
+		long long best_cost = -1;
+
+		for (size_t i = 0; i < rects_.size(); ++i)
+		{
+			for (size_t j = i + 1; j < rects_.size(); ++j)
+			{
+				const auto cost = area(rects_[i].get_union(rects_[j])) - area(rects_[i])
+								  - area(rects_[j]);
+				if (best_cost < 0 || cost < best_cost)
+				{
+					best_cost = cost;
+					best_i	  = i;
+					best_j	  = j;
+				}
+			}
+		}
+
+		const auto merged = rects_[best_i].get_union(rects_[best_j]);
+		rects_.erase(rects_.begin() + std::ptrdiff_t(best_j));
+		rects_.erase(rects_.begin() + std::ptrdiff_t(best_i));
+		add(merged);
+	}
+
+	///Area the region is clipped to
+	Rect bounds_;
+	///Maximum number of rects kept
+	size_t max_rects_;
+	///Disjoint dirty rects
+	std::vector<Rect> rects_;
+};
+
+} // namespace sdl
@@ -191,18 +191,39 @@ public:
 	///Clear events from a specific type from the event queue
 	inline void flush_events(Uint32 type) { flush_events(type, type); }
 
+	///Add events of a specific range of types to the event queue, without allocating
+	///\param events array of events to be added
+	///\param count number of events in the array
+	///\param minType lower type boundary of the range
+	///\param maxType upper type boundary of the range
+	///\return the number of events added, less than count if the queue is full
+	static size_t add_events(Event const* events, size_t count, Uint32 minType, Uint32 maxType)
+	{
+		if (count == 0) return 0;
+
+		// This use of SDL_PeepEvents don't modify the events
+		auto array = const_cast<SDL_Event*>(reinterpret_cast<SDL_Event const*>(events));
+		const auto added = SDL_PeepEvents(array, int(count), SDL_ADDEVENT, minType, maxType);
+		if (added < 0) throw Exception{"SDL_PeepEvents"};
+		return size_t(added);
+	}
+
+	///Add events to the queue, without allocating
+	///\param events array of events to be added
+	///\param count number of events in the array
+	///\return the number of events added
+	static size_t add_events(Event const* events, size_t count)
+	{
+		return add_events(events, count, SDL_FIRSTEVENT, SDL_LASTEVENT);
+	}
+
 	///Add events of a specific range of types to the event queue
 	///\param events vector of events to be added
 	///\param minType lower type boundary of the range
 	///\param maxType upper type boundary of the range
 	inline void add_events(std::vector<Event> const& events, Uint32 minType, Uint32 maxType)
 	{
-		// This use of SDL_PeepEvents don't modify the events
-		auto array = const_cast<SDL_Event*>(reinterpret_cast<SDL_Event const*>(&events[0]));
-		if (SDL_PeepEvents(array, int(events.size()), SDL_ADDEVENT, minType, maxType) < 0)
-		{
-			throw Exception{"SDL_PeepEvents"};
-		}
+		add_events(events.data(), events.size(), minType, maxType);
 	}
 
 	///Add events to the queue
@@ -220,18 +241,32 @@ public:
 		add_events(events, type, type);
 	}
 
+	///Peek at future events into a caller owned array, without allocating
+	///\param events array receiving the events
+	///\param maxEvents max number of events to get, at most the size of the array
+	///\param minType lower bound of event type range
+	///\param maxType upper bound of event type range
+	///\return the number of events written to the array
+	static size_t peek_events(Event* events, size_t maxEvents, Uint32 minType, Uint32 maxType)
+	{
+		return peep_events(events, maxEvents, SDL_PEEKEVENT, minType, maxType);
+	}
+
+	///Peek at future events into a caller owned array, without allocating
+	///\return the number of events written to the array
+	static size_t peek_events(Event* events, size_t maxEvents)
+	{
+		return peek_events(events, maxEvents, SDL_FIRSTEVENT, SDL_LASTEVENT);
+	}
+
 	///Peek at multiple future events
 	///\param maxEvents max number of events to get
 	///\param minType lower bound of event type range
 	///\param maxType upper bound of event type range
 	inline std::vector<Event> peek_events(size_t maxEvents, Uint32 minType, Uint32 maxType)
 	{
-		auto res   = std::vector<Event>(maxEvents);
-		auto array = reinterpret_cast<SDL_Event*>(&res[0]);
-		if (SDL_PeepEvents(array, int(maxEvents), SDL_PEEKEVENT, minType, maxType) < 0)
-		{
-			throw Exception{"SDL_PeepEvents"};
-		}
+		auto res = std::vector<Event>(maxEvents);
+		res.resize(peek_events(res.data(), maxEvents, minType, maxType));
 		return res;
 	}
 
@@ -248,18 +283,32 @@ public:
 		return peek_events(maxEvents, type, type);
 	}
 
+	///Get events from the queue into a caller owned array, without allocating
+	///\param events array receiving the events
+	///\param maxEvents max number of events to get, at most the size of the array
+	///\param minType lower bound of type range
+	///\param maxType upper bound of type range
+	///\return the number of events written to the array
+	static size_t get_events(Event* events, size_t maxEvents, Uint32 minType, Uint32 maxType)
+	{
+		return peep_events(events, maxEvents, SDL_GETEVENT, minType, maxType);
+	}
+
+	///Get events from the queue into a caller owned array, without allocating
+	///\return the number of events written to the array
+	static size_t get_events(Event* events, size_t maxEvents)
+	{
+		return get_events(events, maxEvents, SDL_FIRSTEVENT, SDL_LASTEVENT);
+	}
+
 	///Get events from the queue
 	///\prarm maxEvents max number of events to get
 	///\param minType lower bound of type range
 	///\param maxType upper bound of type range
 	inline std::vector<Event> get_events(size_t maxEvents, Uint32 minType, Uint32 maxType)
 	{
-		auto res   = std::vector<Event>(maxEvents);
-		auto array = reinterpret_cast<SDL_Event*>(&res[0]);
-		if (SDL_PeepEvents(array, int(maxEvents), SDL_GETEVENT, minType, maxType) < 0)
-		{
-			throw Exception{"SDL_PeepEvents"};
-		}
+		auto res = std::vector<Event>(maxEvents);
+		res.resize(get_events(res.data(), maxEvents, minType, maxType));
 		return res;
 	}
 
@@ -331,6 +380,19 @@ public:
 	{
 		SDL_EventState(type, int(state));
 	}
+
+private:
+	///Peek at or get events into an array, and return how many SDL wrote
+	static size_t peep_events(
+		Event* events, size_t maxEvents, SDL_eventaction action, Uint32 minType, Uint32 maxType)
+	{
+		if (maxEvents == 0) return 0;
+
+		const auto count = SDL_PeepEvents(
+			reinterpret_cast<SDL_Event*>(events), int(maxEvents), action, minType, maxType);
+		if (count < 0) throw Exception{"SDL_PeepEvents"};
+		return size_t(count);
+	}
 };
 } // namespace sdl
 
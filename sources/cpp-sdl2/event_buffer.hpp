@@ -0,0 +1,97 @@
+#pragma once
+
+#include "event.hpp"
+
+#include <SDL_events.h>
+
+#include <array>
+#include <climits>
+#include <cstddef>
+
+namespace sdl
+{
+///\brief Fixed size array of events, refilled from the SDL event queue without allocating.
+///
+///Each get() replaces the content with the oldest events of the queue, and returns how many there
+///are: unlike Event::get_events(), nothing is allocated nor cleared. Keep the buffer around
+///between frames, and use drain() to handle every pending event. The events live inside the
+///object: a buffer of 256 events takes 14KiB.
+template<size_t Capacity>
+class EventBuffer
+{
+	static_assert(Capacity > 0 && Capacity <= size_t(INT_MAX), "Invalid event buffer capacity");
+
+public:
+	///Pump the OS events into the SDL queue, then get the oldest events of a range of types.
+	///Only call this from the thread that initialized the video subsystem
+	///\return the number of events got
+	size_t pump(Uint32 minType = SDL_FIRSTEVENT, Uint32 maxType = SDL_LASTEVENT)
+	{
+		SDL_PumpEvents();
+		return get(minType, maxType);
+	}
+
+	///Take the oldest events of a range of types out of the queue
+	///\return the number of events got
+	size_t get(Uint32 minType = SDL_FIRSTEVENT, Uint32 maxType = SDL_LASTEVENT)
+	{
+		size_ = Event::get_events(events_.data(), Capacity, minType, maxType);
+		return size_;
+	}
+
+	///\brief Pump the OS events, then call f on every event of a range of types in the queue.
+	///
+	///Events are taken Capacity at a time, until the queue has no more of them.
+	///\return the number of events handled
+	template<typename F>
+	size_t drain(F&& f, Uint32 minType = SDL_FIRSTEVENT, Uint32 maxType = SDL_LASTEVENT)
+	{
+		size_t total = 0;
+		for (auto n = pump(minType, maxType); n > 0; n = n < Capacity ? 0 : get(minType, maxType))
+		{
+			for (auto& event : *this) f(event);
+			total += n;
+		}
+		return total;
+	}
+
+	///Copy the oldest events of a range of types, leaving them in the queue
+	///\return the number of events got
+	size_t peek(Uint32 minType = SDL_FIRSTEVENT, Uint32 maxType = SDL_LASTEVENT)
+	{
+		size_ = Event::peek_events(events_.data(), Capacity, minType, maxType);
+		return size_;
+	}
+
+	///Forget the events got
+	void clear() { size_ = 0; }
+
+	///Get the number of events got
+	size_t size() const { return size_; }
+	///Get the maximum number of events got at once
+	static constexpr size_t capacity() { return Capacity; }
+	///Return true if no event was got
+	bool empty() const { return size_ == 0; }
+
+	///Get an event
+	Event& operator[](size_t i) { return events_[i]; }
+	///Get an event
+	Event const& operator[](size_t i) const { return events_[i]; }
+
+	///Get the first event
+	Event* begin() { return events_.data(); }
+	///Get the first event
+	Event const* begin() const { return events_.data(); }
+	///Get the end of the events
+	Event* end() { return events_.data() + size_; }
+	///Get the end of the events
+	Event const* end() const { return events_.data() + size_; }
+
+private:
+	///Events storage. Only the first size_ are meaningful
+	std::array<Event, Capacity> events_;
+	///Number of events got
+	size_t size_ = 0;
+};
+
+} // namespace sdl
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "event.hpp"
+
+#include <SDL_events.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace sdl
+{
+///\brief Merges the high frequency events waiting in the SDL queue, once per frame.
+///
+///Gaming mice report motion at 4 to 8kHz, and gamepad sticks about as often: most of those events
+///are overwritten before the frame is drawn. Call coalesce() before polling the events of a frame:
+///every run of SDL_MOUSEMOTION events of a window becomes one event, with the last position and
+///the sum of the relative motions, and every run of SDL_JOYAXISMOTION or SDL_CONTROLLERAXISMOTION
+///events of an axis becomes one event with the last value.
+///
+///A run ends at any other kind of event (e.g. a button press), so events keep their order
+///relative to each other. The queue is walked once with Event::EventFilter::filter_queue(): the
+///first event of a run is kept in place and updated, the following ones are removed.
+class EventCoalescer
+{
+public:
+	///Choose the events to merge
+	explicit EventCoalescer(bool mouse_motion = true, bool axis_motion = true)
+		: filter_{&filter, this}, mouse_motion_{mouse_motion}, axis_motion_{axis_motion}
+	{
+	}
+
+	///The filter points to this object, it is not copyable
+	EventCoalescer(EventCoalescer const&) = delete;
+	///The filter points to this object, it is not copyable
+	EventCoalescer& operator=(EventCoalescer const&) = delete;
+
+	///Merge the events in the queue. Call SDL_PumpEvents() first to merge the latest events
+	///\return the number of events removed from the queue
+	size_t coalesce()
+	{
+		removed_ = 0;
+		filter_.filter_queue();
+		runs_.clear();
+		return removed_;
+	}
+
+	///Set whether SDL_MOUSEMOTION events are merged
+	void set_mouse_motion(bool merge) { mouse_motion_ = merge; }
+	///Set whether SDL_JOYAXISMOTION and SDL_CONTROLLERAXISMOTION events are merged
+	void set_axis_motion(bool merge) { axis_motion_ = merge; }
+
+private:
+	///First event of a run of events of a window or axis, still in the queue
+	struct Run
+	{
+		Uint32 type;
+		///Window of mouse motions, or joystick of axis motions
+		Uint32 id;
+		Uint8  axis;
+		Event* event;
+	};
+
+	///Filter callback: merge an event into its run, or start a run
+	static bool filter(void* coalescer, Event& event)
+	{
+		return static_cast<EventCoalescer*>(coalescer)->merge(event);
+	}
+
+	///Return false if an event was merged into the first event of its run
+	bool merge(Event& event)
+	{
+		switch (event.type)
+		{
+		case SDL_MOUSEMOTION:
+			if (!mouse_motion_) break;
+			if (auto run = find(event.type, event.motion.windowID, 0))
+			{
+				auto& first = run->motion;
+				first.timestamp = event.motion.timestamp;
+				first.which		= event.motion.which;
+				first.state		= event.motion.state;
+				first.x			= event.motion.x;
+				first.y			= event.motion.y;
+				first.xrel += event.motion.xrel;
+				first.yrel += event.motion.yrel;
+				return removed();
+			}
+			runs_.push_back(Run{event.type, event.motion.windowID, 0, &event});
+			return true;
+
+		case SDL_JOYAXISMOTION:
+			if (!axis_motion_) break;
+			if (auto run = find(event.type, Uint32(event.jaxis.which), event.jaxis.axis))
+			{
+				run->jaxis.timestamp = event.jaxis.timestamp;
+				run->jaxis.value	 = event.jaxis.value;
+				return removed();
+			}
+			runs_.push_back(Run{event.type, Uint32(event.jaxis.which), event.jaxis.axis, &event});
+			return true;
+
+		case SDL_CONTROLLERAXISMOTION:
+			if (!axis_motion_) break;
+			if (auto run = find(event.type, Uint32(event.caxis.which), event.caxis.axis))
+			{
+				run->caxis.timestamp = event.caxis.timestamp;
+				run->caxis.value	 = event.caxis.value;
+				return removed();
+			}
+			runs_.push_back(Run{event.type, Uint32(event.caxis.which), event.caxis.axis, &event});
+			return true;
+		}
+
+		// Any other event ends every run, so that nothing moves across it
+		runs_.clear();
+		return true;
+	}
+
+	///Get the first event of the current run of a window or axis, or nullptr
+	Event* find(Uint32 type, Uint32 id, Uint8 axis)
+	{
+		for (auto& run : runs_)
+			if (run.type == type && run.id == id && run.axis == axis) return run.event;
+		return nullptr;
+	}
+
+	///Count a merged event, and return false to remove it from the queue
+	bool removed()
+	{
+		++removed_;
+		return false;
+	}
+
+	///Walks the queue
+	Event::EventFilter filter_;
+	///Runs of the current walk. Kept to reuse its memory
+	std::vector<Run> runs_;
+	///Number of events removed by the current walk
+	size_t removed_ = 0;
+	///Merge SDL_MOUSEMOTION events
+	bool mouse_motion_;
+	///Merge SDL_JOYAXISMOTION and SDL_CONTROLLERAXISMOTION events
+	bool axis_motion_;
+};
+
+} // namespace sdl
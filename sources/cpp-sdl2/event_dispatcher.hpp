@@ -0,0 +1,388 @@
+#pragma once
+
+#include "event.hpp"
+#include "exception.hpp"
+
+#include <SDL_events.h>
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace sdl
+{
+///Handler of the events of one type, made by on()
+template<Uint32 Type, typename F>
+struct EventHandler
+{
+	F f;
+};
+
+///Handler of one of the user event types registered by an EventDispatcher, made by on_user()
+template<Uint32 Index, typename F>
+struct UserEventHandler
+{
+	F f;
+};
+
+///Handler of the events no other handler takes, made by otherwise()
+template<typename F>
+struct DefaultEventHandler
+{
+	F f;
+};
+
+///\brief Handle the events of a type with f.
+///
+///f takes the member of the event for this type (e.g. SDL_KeyboardEvent const& for SDL_KEYDOWN),
+///or the whole Event const&. on<SDL_USEREVENT>() handles every user event type without an
+///on_user() handler.
+template<Uint32 Type, typename F>
+EventHandler<Type, std::decay_t<F>> on(F&& f)
+{
+	return {std::forward<F>(f)};
+}
+
+///Handle with f the user event type number Index registered by the dispatcher. f takes
+///SDL_UserEvent const&, or the whole Event const&
+template<Uint32 Index, typename F>
+UserEventHandler<Index, std::decay_t<F>> on_user(F&& f)
+{
+	return {std::forward<F>(f)};
+}
+
+///Handle with f the events no other handler takes. f takes Event const&
+template<typename F>
+DefaultEventHandler<std::decay_t<F>> otherwise(F&& f)
+{
+	return {std::forward<F>(f)};
+}
+
+namespace details
+{
+///Kind of a handler given to an EventDispatcher
+enum class EventHandlerKind
+{
+	type,
+	user,
+	fallback,
+	invalid
+};
+
+///Tell the kind of a handler, and the event type or user index it handles
+template<typename H>
+struct event_handler_traits
+{
+	static constexpr auto	kind = EventHandlerKind::invalid;
+	static constexpr Uint32 key	 = 0;
+};
+
+template<Uint32 Type, typename F>
+struct event_handler_traits<EventHandler<Type, F>>
+{
+	static constexpr auto	kind = EventHandlerKind::type;
+	static constexpr Uint32 key	 = Type;
+};
+
+template<Uint32 Index, typename F>
+struct event_handler_traits<UserEventHandler<Index, F>>
+{
+	static constexpr auto	kind = EventHandlerKind::user;
+	static constexpr Uint32 key	 = Index;
+};
+
+template<typename F>
+struct event_handler_traits<DefaultEventHandler<F>>
+{
+	static constexpr auto	kind = EventHandlerKind::fallback;
+	static constexpr Uint32 key	 = 0;
+};
+
+///Get the member of an event holding the data of the events of a type
+template<Uint32 Type>
+auto const& event_data(Event const& e)
+{
+	if constexpr (Type >= SDL_USEREVENT) return e.user;
+	else if constexpr (Type == SDL_QUIT) return e.quit;
+	else if constexpr (Type == SDL_WINDOWEVENT) return e.window;
+	else if constexpr (Type == SDL_SYSWMEVENT) return e.syswm;
+	else if constexpr (Type == SDL_KEYDOWN || Type == SDL_KEYUP) return e.key;
+	else if constexpr (Type == SDL_TEXTEDITING) return e.edit;
+	else if constexpr (Type == SDL_TEXTINPUT) return e.text;
+	else if constexpr (Type == SDL_MOUSEMOTION) return e.motion;
+	else if constexpr (Type == SDL_MOUSEBUTTONDOWN || Type == SDL_MOUSEBUTTONUP) return e.button;
+	else if constexpr (Type == SDL_MOUSEWHEEL) return e.wheel;
+	else if constexpr (Type == SDL_JOYAXISMOTION) return e.jaxis;
+	else if constexpr (Type == SDL_JOYBALLMOTION) return e.jball;
+	else if constexpr (Type == SDL_JOYHATMOTION) return e.jhat;
+	else if constexpr (Type == SDL_JOYBUTTONDOWN || Type == SDL_JOYBUTTONUP) return e.jbutton;
+	else if constexpr (Type == SDL_JOYDEVICEADDED || Type == SDL_JOYDEVICEREMOVED) return e.jdevice;
+	else if constexpr (Type == SDL_CONTROLLERAXISMOTION) return e.caxis;
+	else if constexpr (Type == SDL_CONTROLLERBUTTONDOWN || Type == SDL_CONTROLLERBUTTONUP)
+		return e.cbutton;
+	else if constexpr (Type >= SDL_CONTROLLERDEVICEADDED && Type <= SDL_CONTROLLERDEVICEREMAPPED)
+		return e.cdevice;
+	else if constexpr (Type >= SDL_FINGERDOWN && Type <= SDL_FINGERMOTION) return e.tfinger;
+	else if constexpr (Type == SDL_DOLLARGESTURE || Type == SDL_DOLLARRECORD) return e.dgesture;
+	else if constexpr (Type == SDL_MULTIGESTURE) return e.mgesture;
+	// SDL_DROPFILE, then SDL_DROPTEXT, SDL_DROPBEGIN and SDL_DROPCOMPLETE since 2.0.5
+	else if constexpr (Type >= SDL_DROPFILE && Type <= SDL_DROPFILE + 3) return e.drop;
+	else if constexpr (Type == SDL_AUDIODEVICEADDED || Type == SDL_AUDIODEVICEREMOVED)
+		return e.adevice;
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+	else if constexpr (Type == SDL_DISPLAYEVENT) return e.display;
+	else if constexpr (Type == SDL_SENSORUPDATE) return e.sensor;
+#endif
+	else return e.common;
+}
+
+///Size of the table of built-in event types: 32 entries for each block of 256 types up to the
+///render events, and one for the types out of the table
+constexpr size_t event_table_size = 0x21 * 32 + 1;
+
+///\brief Get the index of a built-in event type in the dispatch table.
+///
+///SDL numbers its events by blocks of 256 (0x300 keyboard, 0x400 mouse...), and only uses the 16
+///first types of a block, and the 16 types from 0x50 (display, game controllers). Return the last
+///index for the types out of those ranges.
+constexpr size_t event_table_index(Uint32 type)
+{
+	const auto block = type >> 8, offset = type & 0xFF;
+	if (block > 0x20) return event_table_size - 1;
+	if (offset < 0x10) return block * 32 + offset;
+	if (offset >= 0x50 && offset < 0x60) return block * 32 + 0x10 + offset - 0x50;
+	return event_table_size - 1;
+}
+
+///Get the number of user event types handled: one more than the greatest on_user() index
+template<size_t N>
+constexpr Uint32 user_event_count(
+	std::array<EventHandlerKind, N> const& kinds, std::array<Uint32, N> const& keys)
+{
+	Uint32 count = 0;
+	for (size_t i = 0; i < N; ++i)
+		if (kinds[i] == EventHandlerKind::user && keys[i] >= count) count = keys[i] + 1;
+	return count;
+}
+
+///Return true if every handler type is known and fits in the dispatch table
+template<size_t N>
+constexpr bool event_handlers_known(
+	std::array<EventHandlerKind, N> const& kinds, std::array<Uint32, N> const& keys)
+{
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (kinds[i] == EventHandlerKind::invalid) return false;
+		if (kinds[i] == EventHandlerKind::type && keys[i] < SDL_USEREVENT
+			&& event_table_index(keys[i]) == event_table_size - 1)
+			return false;
+	}
+	return true;
+}
+
+///Return true if no two handlers take the same events
+template<size_t N>
+constexpr bool event_handlers_unique(
+	std::array<EventHandlerKind, N> const& kinds, std::array<Uint32, N> const& keys)
+{
+	for (size_t i = 0; i < N; ++i)
+		for (size_t j = i + 1; j < N; ++j)
+			if (kinds[i] == kinds[j]
+				&& (kinds[i] == EventHandlerKind::fallback || keys[i] == keys[j]
+					|| (kinds[i] == EventHandlerKind::type && keys[i] >= SDL_USEREVENT
+						&& keys[j] >= SDL_USEREVENT)))
+				return false;
+	return true;
+}
+
+///Handler numbers of the event types, offset by one: 0 means the event is not handled
+template<Uint32 UserCount>
+struct EventTables
+{
+	///Built-in types, see event_table_index()
+	std::array<Uint8, event_table_size> types{};
+	///User types registered by the dispatcher
+	std::array<Uint8, (UserCount > 0 ? UserCount : 1)> user{};
+	///Other user types
+	Uint8 other_user = 0;
+};
+
+///Build the tables of an EventDispatcher
+template<Uint32 UserCount, size_t N>
+constexpr EventTables<UserCount> make_event_tables(
+	std::array<EventHandlerKind, N> const& kinds, std::array<Uint32, N> const& keys)
+{
+	EventTables<UserCount> tables{};
+
+	Uint8 fallback = 0;
+	for (size_t i = 0; i < N; ++i)
+		if (kinds[i] == EventHandlerKind::fallback) fallback = Uint8(i + 1);
+	Uint8 other_user = fallback;
+	for (size_t i = 0; i < N; ++i)
+		if (kinds[i] == EventHandlerKind::type && keys[i] >= SDL_USEREVENT)
+			other_user = Uint8(i + 1);
+
+	for (auto& slot : tables.types) slot = fallback;
+	for (auto& slot : tables.user) slot = other_user;
+	tables.other_user = other_user;
+
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (kinds[i] == EventHandlerKind::type && keys[i] < SDL_USEREVENT)
+			tables.types[event_table_index(keys[i])] = Uint8(i + 1);
+		else if (kinds[i] == EventHandlerKind::user)
+			tables.user[keys[i]] = Uint8(i + 1);
+	}
+	return tables;
+}
+
+///Call f with the data of an event if it takes it, with the whole event otherwise
+template<typename F, typename Data>
+void invoke_event_handler(F& f, Data const& data, Event const& e)
+{
+	if constexpr (std::is_invocable_v<F&, Data const&>)
+		f(data);
+	else
+		f(e);
+}
+
+///Entry of the jump table of an EventDispatcher for events no handler takes
+template<typename Tuple>
+bool ignore_event(Tuple&, Event const&)
+{
+	return false;
+}
+
+///Entry of the jump table of an EventDispatcher calling the handler number I
+template<typename Tuple, size_t I>
+bool call_event_handler(Tuple& handlers, Event const& e)
+{
+	using traits = event_handler_traits<std::tuple_element_t<I, Tuple>>;
+	auto& f		 = std::get<I>(handlers).f;
+
+	if constexpr (traits::kind == EventHandlerKind::type)
+		invoke_event_handler(f, event_data<traits::key>(e), e);
+	else if constexpr (traits::kind == EventHandlerKind::user)
+		invoke_event_handler(f, e.user, e);
+	else
+		f(e);
+	return true;
+}
+
+///Build the jump table of an EventDispatcher
+template<typename Tuple, size_t... I>
+constexpr auto make_event_thunks(std::index_sequence<I...>)
+{
+	using thunk = bool (*)(Tuple&, Event const&);
+	return std::array<thunk, sizeof...(I) + 1>{{&ignore_event<Tuple>,
+												&call_event_handler<Tuple, I>...}};
+}
+} // namespace details
+
+///\brief Calls the handler of the type of an event, in constant time.
+///
+///The handlers are made by on(), on_user() and otherwise():
+///
+///    sdl::EventDispatcher dispatch{
+///        sdl::on<SDL_QUIT>([&](SDL_QuitEvent const&) { running = false; }),
+///        sdl::on<SDL_KEYDOWN>([&](SDL_KeyboardEvent const& key) { ... }),
+///        sdl::on_user<0>([&](SDL_UserEvent const& user) { ... }),
+///        sdl::otherwise([&](sdl::Event const& e) { ... })};
+///    dispatch.register_user_events();
+///    while (sdl::Event::poll(e)) dispatch(e);
+///
+///The event types are mapped to the handlers at compile time, in a table of 1KiB built from the
+///blocks SDL numbers its events in. Dispatching an event is then two table lookups and a call,
+///where the handler is inlined, whatever the number of handlers.
+template<typename... Handlers>
+class EventDispatcher
+{
+	using handler_tuple = std::tuple<Handlers...>;
+
+	static constexpr std::array<details::EventHandlerKind, sizeof...(Handlers)> kinds_{
+		{details::event_handler_traits<Handlers>::kind...}};
+	static constexpr std::array<Uint32, sizeof...(Handlers)> keys_{
+		{details::event_handler_traits<Handlers>::key...}};
+
+public:
+	///Number of user event types handled by on_user(): one more than the greatest index
+	static constexpr Uint32 user_event_count = details::user_event_count(kinds_, keys_);
+
+	///Take the handlers
+	explicit EventDispatcher(Handlers... handlers) : handlers_{std::move(handlers)...}
+	{
+		static_assert(sizeof...(Handlers) < 256, "Too many event handlers");
+		static_assert(
+			details::event_handlers_known(kinds_, keys_),
+			"Event handlers must be made by on(), on_user() or otherwise(), for known event types");
+		static_assert(
+			details::event_handlers_unique(kinds_, keys_), "Several handlers take the same events");
+	}
+
+	///Register the user event types of the on_user() handlers with SDL
+	///\return the type of on_user<0>()
+	Uint32 register_user_events()
+	{
+		static_assert(user_event_count > 0, "No on_user() handler");
+
+		const auto base = SDL_RegisterEvents(int(user_event_count));
+		if (base == Uint32(-1))
+		{
+			SDL_SetError("Not enough user event types left for %u", unsigned(user_event_count));
+			throw Exception{"SDL_RegisterEvents"};
+		}
+		set_user_base(base);
+		return base;
+	}
+
+	///Handle the user event types from base, registered elsewhere, with the on_user() handlers
+	void set_user_base(Uint32 base)
+	{
+		user_base_	= base;
+		user_count_ = user_event_count;
+	}
+
+	///Get the type of the user events handled by on_user<Index>(). Only meaningful once the types
+	///are registered
+	template<Uint32 Index>
+	Uint32 user_type() const
+	{
+		static_assert(Index < user_event_count, "No on_user() handler for this index");
+		return user_base_ + Index;
+	}
+
+	///Call the handler of an event
+	///\return false if no handler took the event
+	bool dispatch(Event const& e) { return thunks_[slot(e.type)](handlers_, e); }
+
+	///Call the handler of an event
+	///\return false if no handler took the event
+	bool operator()(Event const& e) { return dispatch(e); }
+
+private:
+	///Get the entry of the jump table for an event type
+	Uint8 slot(Uint32 type) const
+	{
+		if (type < SDL_USEREVENT) return tables_.types[details::event_table_index(type)];
+
+		const auto index = type - user_base_;
+		return index < user_count_ ? tables_.user[index] : tables_.other_user;
+	}
+
+	///Handler number of each event type
+	static constexpr auto tables_ =
+		details::make_event_tables<user_event_count>(kinds_, keys_);
+	///Functions calling each handler, after one ignoring the event
+	static constexpr auto thunks_ = details::make_event_thunks<handler_tuple>(
+		std::index_sequence_for<Handlers...>{});
+
+	handler_tuple handlers_;
+	///First user event type handled by on_user()
+	Uint32 user_base_ = 0;
+	///Number of user event types handled by on_user(), 0 until they are registered
+	Uint32 user_count_ = 0;
+};
+
+} // namespace sdl
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "event.hpp"
+#include "exception.hpp"
+
+#include <SDL_events.h>
+#include <SDL_timer.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace sdl
+{
+///\brief Lock-free queue worker threads post events into, to be handled by the main loop.
+///
+///Event::push() goes through SDL_PushEvent(), which locks the SDL event queue for each event.
+///Here, any number of threads post() into a fixed ring of events with one atomic operation and
+///no lock, and a single thread (the main loop) drains it once per frame: either straight into a
+///handler, or into the SDL queue with one SDL_PeepEvents() call per 128 events. When the ring is
+///full, post() fails instead of waiting.
+class EventQueue
+{
+public:
+	///Allocate the ring
+	///\param capacity maximum number of events waiting, rounded up to a power of 2
+	///\param type type of the events made by post(code, data1, data2). By default, a new user
+	///event type is registered
+	explicit EventQueue(size_t capacity = 4096, Uint32 type = 0) : type_{type}
+	{
+		size_t size = 2;
+		while (size < capacity) size *= 2;
+		cells_.reset(new Cell[size]);
+		mask_ = size - 1;
+		for (size_t i = 0; i < size; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+
+		if (type_ == 0)
+		{
+			type_ = SDL_RegisterEvents(1);
+			if (type_ == Uint32(-1))
+			{
+				SDL_SetError("No user event type left");
+				throw Exception{"SDL_RegisterEvents"};
+			}
+		}
+	}
+
+	///This object is shared by threads, it is not copyable
+	EventQueue(EventQueue const&) = delete;
+	///This object is shared by threads, it is not copyable
+	EventQueue& operator=(EventQueue const&) = delete;
+
+	///Get the type of the events made by post(code, data1, data2)
+	Uint32 type() const { return type_; }
+	///Get the maximum number of events waiting
+	size_t capacity() const { return mask_ + 1; }
+
+	///Queue an event, from any thread
+	///\return false if the queue is full
+	bool post(Event const& event)
+	{
+		auto pos = tail_.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell			= &cells_[pos & mask_];
+			const auto seq	= cell->sequence.load(std::memory_order_acquire);
+			const auto diff = intptr_t(seq) - intptr_t(pos);
+			if (diff == 0)
+			{
+				if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+			}
+			else if (diff < 0)
+			{
+				// The consumer has not taken the event written a lap ago
+				return false;
+			}
+			else
+			{
+				pos = tail_.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->event = event;
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	///Queue a user event of type(), from any thread
+	///\return false if the queue is full
+	bool post(Sint32 code, void* data1 = nullptr, void* data2 = nullptr)
+	{
+		Event event;
+		event.user.type		 = type_;
+		event.user.timestamp = SDL_GetTicks();
+		event.user.code		 = code;
+		event.user.data1	 = data1;
+		event.user.data2	 = data2;
+		return post(event);
+	}
+
+	///Take the oldest event. Only call this from the thread draining the queue
+	///\return false if the queue is empty
+	bool pop(Event& event)
+	{
+		auto&	   cell = cells_[head_ & mask_];
+		const auto seq	= cell.sequence.load(std::memory_order_acquire);
+		if (seq != head_ + 1) return false;
+
+		event = cell.event;
+		cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+		++head_;
+		return true;
+	}
+
+	///Call f on every queued event, without going through the SDL queue. Only call this from the
+	///thread draining the queue
+	///\return the number of events handled
+	template<typename F>
+	size_t drain(F&& f)
+	{
+		size_t count = 0;
+		Event  event;
+		for (; count <= mask_ && pop(event); ++count) f(static_cast<Event const&>(event));
+		return count;
+	}
+
+	///\brief Move the queued events into the SDL event queue, locking it once per 128 events.
+	///
+	///Only call this from the thread draining the queue. Events the SDL queue has no room for
+	///are kept for the next call.
+	///\return the number of events added to the SDL queue
+	size_t drain()
+	{
+		size_t added = 0, taken = 0;
+		for (;;)
+		{
+			while (pending_ < batch_.size() && taken <= mask_ && pop(batch_[pending_]))
+			{
+				++pending_;
+				++taken;
+			}
+			if (pending_ == 0) break;
+
+			const auto full = pending_ == batch_.size();
+			const auto n	= Event::add_events(batch_.data(), pending_);
+			std::copy(batch_.begin() + n, batch_.begin() + pending_, batch_.begin());
+			pending_ -= n;
+			added += n;
+			if (pending_ > 0 || !full) break;
+		}
+		return added;
+	}
+
+private:
+	///Slot of the ring. sequence tells whether the slot is free or holds an event to take
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		Event				event;
+	};
+
+	///Ring of events
+	std::unique_ptr<Cell[]> cells_;
+	///Capacity - 1, to wrap positions
+	size_t mask_;
+	///Type of the events made by post(code, data1, data2)
+	Uint32 type_;
+
+	///Position of the next event posted, on its own cache line as every producer writes it
+	alignas(64) std::atomic<size_t> tail_{0};
+	///Position of the next event taken, only used by the consumer
+	alignas(64) size_t head_ = 0;
+	///Events taken out of the ring and not added to the SDL queue yet
+	std::array<Event, 128> batch_;
+	///Number of meaningful events in batch_
+	size_t pending_ = 0;
+};
+
+} // namespace sdl
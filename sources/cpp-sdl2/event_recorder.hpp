@@ -0,0 +1,313 @@
+#pragma once
+
+#include "event.hpp"
+#include "exception.hpp"
+
+#include <SDL_events.h>
+#include <SDL_rwops.h>
+#include <SDL_timer.h>
+
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sdl
+{
+namespace details
+{
+///First bytes of an event recording, followed by sizeof(SDL_Event) as a Uint32
+constexpr char event_recording_magic[8] = {'S', 'D', 'L', 'E', 'V', 'R', 'E', 'C'};
+
+///Return true if the events of a type can be recorded and replayed. Events pointing to memory
+///owned by SDL or the application can't, nor the sentinels SDL_PollEvent() pushes to the queue
+///on every pump, which would end the poll loop of the application early when replayed
+inline bool event_replayable(Uint32 type)
+{
+	switch (type)
+	{
+	case SDL_SYSWMEVENT:
+	case SDL_DROPFILE:
+#if SDL_VERSION_ATLEAST(2, 0, 5)
+	case SDL_DROPTEXT:
+#endif
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	case SDL_POLLSENTINEL:
+#endif
+#if SDL_VERSION_ATLEAST(2, 0, 22)
+	case SDL_TEXTEDITING_EXT:
+#endif
+		return false;
+	default: return true;
+	}
+}
+} // namespace details
+
+///\brief Writes every event pushed to the SDL queue to a binary file, to replay it later with an
+///EventReplayer.
+///
+///Events are caught by an event watcher, on the thread pushing them, and buffered: the file is
+///written 64KiB at a time. Each event takes its time since the start of the recording, its size,
+///and its bytes without the trailing zeros: 10 to 30 bytes for input events. Recordings use the
+///byte order of the machine, and are meant to be replayed with the same build of SDL.
+///
+///Events pointing to memory (dropped files and text, system events) and the poll sentinels of
+///SDL 2.0.18 are not recorded, and the data pointers of user events are cleared.
+class EventRecorder
+{
+public:
+	///Create or truncate a file, and start recording
+	explicit EventRecorder(std::string const& filename)
+		: file_{SDL_RWFromFile(filename.c_str(), "wb")}, watcher_{&watch, this}
+	{
+		if (!file_) throw Exception{"SDL_RWFromFile"};
+
+		const Uint32 event_size = sizeof(SDL_Event);
+		append(details::event_recording_magic, sizeof details::event_recording_magic);
+		append(&event_size, sizeof event_size);
+		start_ = SDL_GetTicks();
+		watcher_.add_watcher();
+	}
+
+	///Stop recording, and write the buffered events
+	~EventRecorder()
+	{
+		watcher_.del_watcher();
+		std::lock_guard<std::mutex> lock{mutex_};
+		write_buffer();
+		SDL_RWclose(file_);
+	}
+
+	///This object is registered as an event watcher, it is not copyable
+	EventRecorder(EventRecorder const&) = delete;
+	///This object is registered as an event watcher, it is not copyable
+	EventRecorder& operator=(EventRecorder const&) = delete;
+
+	///Record an event that didn't go through the SDL queue. Thread safe
+	void record(Event const& event)
+	{
+		if (!details::event_replayable(event.type)) return;
+
+		Event copy = event;
+		if (copy.type >= SDL_USEREVENT) copy.user.data1 = copy.user.data2 = nullptr;
+
+		auto  bytes = reinterpret_cast<Uint8 const*>(copy.ptr());
+		Uint8 size	= sizeof(SDL_Event);
+		while (size > 0 && bytes[size - 1] == 0) --size;
+
+		std::lock_guard<std::mutex> lock{mutex_};
+		const Uint32 time = copy.common.timestamp > start_ ? copy.common.timestamp - start_ : 0;
+		append(&time, sizeof time);
+		append(&size, sizeof size);
+		append(bytes, size);
+		++count_;
+
+		if (buffer_.size() >= flush_size) write_buffer();
+	}
+
+	///Write the buffered events to the file. Throws if writing failed since the last call
+	void flush()
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		write_buffer();
+		if (failed_)
+		{
+			failed_ = false;
+			throw Exception{"SDL_RWwrite"};
+		}
+	}
+
+	///Get the number of events recorded
+	size_t count() const
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		return count_;
+	}
+
+private:
+	///Size of the buffer written at once
+	static constexpr size_t flush_size = 64 * 1024;
+
+	///Event watcher callback
+	static bool watch(void* recorder, Event& event)
+	{
+		static_cast<EventRecorder*>(recorder)->record(event);
+		return true;
+	}
+
+	///Add bytes to the buffer
+	void append(void const* data, size_t size)
+	{
+		auto bytes = static_cast<Uint8 const*>(data);
+		buffer_.insert(buffer_.end(), bytes, bytes + size);
+	}
+
+	///Write the buffer to the file. Failures are kept for flush(), as watchers can't throw
+	void write_buffer()
+	{
+		if (buffer_.empty()) return;
+		if (SDL_RWwrite(file_, buffer_.data(), 1, buffer_.size()) != buffer_.size()) failed_ = true;
+		buffer_.clear();
+	}
+
+	///File written to
+	SDL_RWops* file_;
+	///Registers this object as an event watcher
+	Event::EventFilter watcher_;
+	///Time the recording started at, in milliseconds
+	Uint32 start_ = 0;
+
+	///Protect the members below, events are pushed from any thread
+	mutable std::mutex mutex_;
+	///Records not written yet
+	std::vector<Uint8> buffer_;
+	///Number of events recorded
+	size_t count_ = 0;
+	///True if writing failed since the last flush()
+	bool failed_ = false;
+};
+
+///\brief Adds the events of a recording made by an EventRecorder to the SDL queue, at their
+///recorded times.
+///
+///The whole recording is loaded at once. Call update() once per frame, before polling events, to
+///replay them at the original speed or faster; or advance() with the duration of a fixed frame to
+///replay them in the same frames on every run, whatever the time frames take. Replayed events
+///are stamped with the time they are added at.
+class EventReplayer
+{
+public:
+	///Load a recording
+	///\param speed how much faster than recorded update() replays events
+	explicit EventReplayer(std::string const& filename, double speed = 1) : speed_{speed}
+	{
+		auto file = SDL_RWFromFile(filename.c_str(), "rb");
+		if (!file) throw Exception{"SDL_RWFromFile"};
+
+		const auto		   size = SDL_RWsize(file);
+		std::vector<Uint8> data(size_t(size > 0 ? size : 0));
+		const auto		   read = SDL_RWread(file, data.data(), 1, data.size());
+		SDL_RWclose(file);
+		if (size < 0 || read != data.size()) throw Exception{"SDL_RWread"};
+
+		if (!parse(data))
+		{
+			SDL_SetError("%s is not an event recording of this platform", filename.c_str());
+			throw Exception{"EventReplayer"};
+		}
+	}
+
+	///\brief Add to the SDL queue the events recorded up to the time elapsed since the first call,
+	///multiplied by speed().
+	///\return the number of events added
+	size_t update()
+	{
+		const auto now = SDL_GetTicks();
+		if (!started_)
+		{
+			started_ = true;
+			last_	 = now;
+		}
+		clock_ += (now - last_) * speed_;
+		last_ = now;
+		return play_until(Uint32(clock_));
+	}
+
+	///Move the replay time forward by a duration of the recording, without looking at the real
+	///time, and add to the SDL queue the events recorded up to it
+	///\return the number of events added
+	size_t advance(Uint32 milliseconds)
+	{
+		clock_ += milliseconds;
+		return play_until(Uint32(clock_));
+	}
+
+	///Add to the SDL queue the events recorded up to a time after the start of the recording.
+	///Events the queue has no room for are added by the next call
+	///\return the number of events added
+	size_t play_until(Uint32 time)
+	{
+		auto end = position_;
+		while (end < events_.size() && times_[end] <= time) ++end;
+		if (end == position_) return 0;
+
+		const auto now = SDL_GetTicks();
+		for (auto i = position_; i < end; ++i) events_[i].common.timestamp = now;
+
+		const auto added = Event::add_events(events_.data() + position_, end - position_);
+		position_ += added;
+		return added;
+	}
+
+	///Replay from the first event
+	void restart()
+	{
+		position_ = 0;
+		clock_	  = 0;
+		started_  = false;
+	}
+
+	///Set how much faster than recorded update() replays events
+	void set_speed(double speed) { speed_ = speed; }
+	///Get how much faster than recorded update() replays events
+	double speed() const { return speed_; }
+
+	///Get the number of events recorded
+	size_t size() const { return events_.size(); }
+	///Get the number of events replayed
+	size_t position() const { return position_; }
+	///Return true once every event is replayed
+	bool done() const { return position_ == events_.size(); }
+	///Get the time of the last event, in milliseconds after the start of the recording
+	Uint32 duration() const { return times_.empty() ? 0 : times_.back(); }
+
+private:
+	///Read the events of a recording. Return false if it isn't one
+	bool parse(std::vector<Uint8> const& data)
+	{
+		constexpr auto header_size = sizeof details::event_recording_magic + sizeof(Uint32);
+		Uint32		   event_size;
+		if (data.size() < header_size
+			|| memcmp(data.data(), details::event_recording_magic, header_size - sizeof(Uint32)))
+			return false;
+		memcpy(&event_size, data.data() + header_size - sizeof(Uint32), sizeof event_size);
+		if (event_size != sizeof(SDL_Event)) return false;
+
+		for (auto pos = header_size; pos < data.size();)
+		{
+			Uint32 time;
+			if (data.size() - pos < sizeof time + 1) return false;
+			memcpy(&time, data.data() + pos, sizeof time);
+			const size_t size = data[pos + sizeof time];
+			pos += sizeof time + 1;
+			if (size > sizeof(SDL_Event) || data.size() - pos < size) return false;
+
+			Event event;
+			memcpy(event.ptr(), data.data() + pos, size);
+			if (!details::event_replayable(event.type)) return false;
+			pos += size;
+			times_.push_back(time);
+			events_.push_back(event);
+		}
+		return true;
+	}
+
+	///Recorded events
+	std::vector<Event> events_;
+	///Time of each event, in milliseconds after the start of the recording
+	std::vector<Uint32> times_;
+	///Number of events replayed
+	size_t position_ = 0;
+
+	///How much faster than recorded update() replays events
+	double speed_;
+	///Replay time, in milliseconds after the start of the recording
+	double clock_ = 0;
+	///Real time of the last update()
+	Uint32 last_ = 0;
+	///True once update() was called
+	bool started_ = false;
+};
+
+} // namespace sdl
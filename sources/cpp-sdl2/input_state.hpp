@@ -0,0 +1,276 @@
+#pragma once
+
+#include "event.hpp"
+#include "vec2.hpp"
+
+#include <SDL_events.h>
+#include <SDL_gamecontroller.h>
+#include <SDL_keyboard.h>
+#include <SDL_mouse.h>
+
+#include <array>
+#include <cstddef>
+
+namespace sdl
+{
+///\brief State of the keyboard, mouse and game controllers, updated from events and read in
+///constant time.
+///
+///Give every event of a frame to handle(), then call next_frame(): the state gathered becomes
+///the one the queries read, until the next call. Besides whether a key or button is held, the
+///queries tell whether it was pressed or released during the frame, even when both happened.
+///
+///The state lives in two sets of flat arrays, one written by handle() and one read by the
+///queries, swapped by next_frame(): no query calls into SDL. Controllers are identified by their
+///joystick instance id, as in their events; the first max_controllers ones seen are tracked.
+class InputState
+{
+public:
+	///Number of game controllers tracked at once
+	static constexpr size_t max_controllers = 8;
+
+	///Start with nothing held
+	InputState()
+	{
+		for (auto& frame : frames_) frame.controller_ids.fill(no_controller);
+	}
+
+	///Update the state being gathered from an event
+	void handle(Event const& event)
+	{
+		auto& frame = back();
+		switch (event.type)
+		{
+		case SDL_KEYDOWN:
+			if (!event.key.repeat) press(key(frame, event.key.keysym.scancode));
+			break;
+		case SDL_KEYUP: release(key(frame, event.key.keysym.scancode)); break;
+
+		case SDL_MOUSEMOTION:
+			frame.mouse_position = Vec2i{event.motion.x, event.motion.y};
+			frame.mouse_motion += Vec2i{event.motion.xrel, event.motion.yrel};
+			break;
+		case SDL_MOUSEBUTTONDOWN: press(mouse_button(frame, event.button.button)); break;
+		case SDL_MOUSEBUTTONUP: release(mouse_button(frame, event.button.button)); break;
+		case SDL_MOUSEWHEEL:
+		{
+			const auto flip = event.wheel.direction == SDL_MOUSEWHEEL_FLIPPED ? -1 : 1;
+			frame.mouse_wheel += Vec2i{event.wheel.x * flip, event.wheel.y * flip};
+			break;
+		}
+
+		case SDL_CONTROLLERBUTTONDOWN:
+			if (auto slot = controller_slot(frame, event.cbutton.which, true);
+				slot < max_controllers)
+				press(controller_button(frame, slot, event.cbutton.button));
+			break;
+		case SDL_CONTROLLERBUTTONUP:
+			if (auto slot = controller_slot(frame, event.cbutton.which, true);
+				slot < max_controllers)
+				release(controller_button(frame, slot, event.cbutton.button));
+			break;
+		case SDL_CONTROLLERAXISMOTION:
+			if (auto slot = controller_slot(frame, event.caxis.which, true);
+				slot < max_controllers && event.caxis.axis < SDL_CONTROLLER_AXIS_MAX)
+				frame.axes[slot][event.caxis.axis] = event.caxis.value;
+			break;
+		case SDL_CONTROLLERDEVICEREMOVED:
+			if (auto slot = controller_slot(frame, event.cdevice.which, false);
+				slot < max_controllers)
+			{
+				frame.controller_ids[slot] = no_controller;
+				frame.buttons[slot].fill(0);
+				frame.axes[slot].fill(0);
+			}
+			break;
+		}
+	}
+
+	///Make the state gathered since the last call the one read by the queries
+	void next_frame()
+	{
+		front_ ^= 1;
+		auto const& front = frames_[front_];
+		auto&		back  = this->back();
+
+		// Gathering starts again from what is held, without the presses and releases
+		copy_held(front.keys, back.keys);
+		copy_held(front.mouse_buttons, back.mouse_buttons);
+		for (size_t i = 0; i < max_controllers; ++i) copy_held(front.buttons[i], back.buttons[i]);
+		back.controller_ids = front.controller_ids;
+		back.axes			= front.axes;
+		back.mouse_position = front.mouse_position;
+		back.mouse_motion	= Vec2i{};
+		back.mouse_wheel	= Vec2i{};
+	}
+
+	///Return true if a key is down
+	bool key_held(SDL_Scancode code) const { return has(key(code), held); }
+	///Return true if a key was pressed during the frame
+	bool key_pressed(SDL_Scancode code) const { return has(key(code), pressed); }
+	///Return true if a key was released during the frame
+	bool key_released(SDL_Scancode code) const { return has(key(code), released); }
+
+	///Return true if a mouse button (SDL_BUTTON_LEFT...) is down
+	bool mouse_button_held(Uint8 button) const { return has(mouse_button(button), held); }
+	///Return true if a mouse button was pressed during the frame
+	bool mouse_button_pressed(Uint8 button) const { return has(mouse_button(button), pressed); }
+	///Return true if a mouse button was released during the frame
+	bool mouse_button_released(Uint8 button) const { return has(mouse_button(button), released); }
+
+	///Get the position of the mouse in its window
+	Vec2i mouse_position() const { return front().mouse_position; }
+	///Get the motion of the mouse during the frame
+	Vec2i mouse_motion() const { return front().mouse_motion; }
+	///Get the wheel scrolling during the frame, positive away from the user and to the right
+	Vec2i mouse_wheel() const { return front().mouse_wheel; }
+
+	///Return true if a button of a controller is down
+	bool controller_button_held(SDL_JoystickID id, SDL_GameControllerButton button) const
+	{
+		return has(controller_button(id, button), held);
+	}
+	///Return true if a button of a controller was pressed during the frame
+	bool controller_button_pressed(SDL_JoystickID id, SDL_GameControllerButton button) const
+	{
+		return has(controller_button(id, button), pressed);
+	}
+	///Return true if a button of a controller was released during the frame
+	bool controller_button_released(SDL_JoystickID id, SDL_GameControllerButton button) const
+	{
+		return has(controller_button(id, button), released);
+	}
+
+	///Get the value of an axis of a controller, as GameController::get_axis()
+	Sint16 controller_axis(SDL_JoystickID id, SDL_GameControllerAxis axis) const
+	{
+		auto& frame = front();
+		const auto slot = controller_slot(frame, id);
+		if (slot >= max_controllers || size_t(axis) >= SDL_CONTROLLER_AXIS_MAX) return 0;
+		return frame.axes[slot][axis];
+	}
+
+private:
+	///Flags of a key or button
+	enum : Uint8
+	{
+		held	 = 1,
+		pressed	 = 2,
+		released = 4
+	};
+
+	///Controller id of an unused slot
+	static constexpr SDL_JoystickID no_controller = -1;
+
+	///One set of flat arrays
+	struct Frame
+	{
+		std::array<Uint8, SDL_NUM_SCANCODES> keys{};
+		///Indexed by SDL_BUTTON_LEFT...
+		std::array<Uint8, 8> mouse_buttons{};
+		Vec2i				 mouse_position;
+		Vec2i				 mouse_motion;
+		Vec2i				 mouse_wheel;
+
+		///Instance id of the controller in each slot
+		std::array<SDL_JoystickID, max_controllers> controller_ids;
+		///Buttons of each slot
+		std::array<std::array<Uint8, SDL_CONTROLLER_BUTTON_MAX>, max_controllers> buttons{};
+		///Axes of each slot
+		std::array<std::array<Sint16, SDL_CONTROLLER_AXIS_MAX>, max_controllers> axes{};
+	};
+
+	///Frame read by the queries
+	Frame const& front() const { return frames_[front_]; }
+	///Frame written by handle()
+	Frame& back() { return frames_[front_ ^ 1]; }
+
+	///Return true if a flag is set
+	static bool has(Uint8 state, Uint8 flag) { return (state & flag) != 0; }
+
+	///Mark a key or button as pressed
+	static void press(Uint8& state)
+	{
+		if (!has(state, held)) state |= held | pressed;
+	}
+
+	///Mark a key or button as released
+	static void release(Uint8& state)
+	{
+		if (has(state, held)) state = Uint8((state & ~held) | released);
+	}
+
+	///Copy the held flags of an array into another
+	template<size_t N>
+	static void copy_held(std::array<Uint8, N> const& from, std::array<Uint8, N>& to)
+	{
+		for (size_t i = 0; i < N; ++i) to[i] = from[i] & held;
+	}
+
+	///Get the slot of a controller, or max_controllers. Optionally give it a free slot
+	static size_t controller_slot(Frame& frame, SDL_JoystickID id, bool add)
+	{
+		auto slot = controller_slot(frame, id);
+		if (slot < max_controllers || !add) return slot;
+
+		slot = controller_slot(frame, no_controller);
+		if (slot < max_controllers) frame.controller_ids[slot] = id;
+		return slot;
+	}
+
+	///Get the slot of a controller, or max_controllers
+	static size_t controller_slot(Frame const& frame, SDL_JoystickID id)
+	{
+		size_t slot = 0;
+		while (slot < max_controllers && frame.controller_ids[slot] != id) ++slot;
+		return slot;
+	}
+
+	///Get the state of a key being gathered. Unknown keys share a dummy state
+	Uint8& key(Frame& frame, SDL_Scancode code)
+	{
+		return size_t(code) < frame.keys.size() ? frame.keys[code] : dummy_;
+	}
+
+	///Get the state of a mouse button being gathered
+	Uint8& mouse_button(Frame& frame, Uint8 button)
+	{
+		return button < frame.mouse_buttons.size() ? frame.mouse_buttons[button] : dummy_;
+	}
+
+	///Get the state of a controller button being gathered
+	Uint8& controller_button(Frame& frame, size_t slot, Uint8 button)
+	{
+		return button < SDL_CONTROLLER_BUTTON_MAX ? frame.buttons[slot][button] : dummy_;
+	}
+
+	///Get the state of a key
+	Uint8 key(SDL_Scancode code) const
+	{
+		return size_t(code) < front().keys.size() ? front().keys[code] : 0;
+	}
+
+	///Get the state of a mouse button
+	Uint8 mouse_button(Uint8 button) const
+	{
+		return button < front().mouse_buttons.size() ? front().mouse_buttons[button] : 0;
+	}
+
+	///Get the state of a controller button
+	Uint8 controller_button(SDL_JoystickID id, SDL_GameControllerButton button) const
+	{
+		auto& frame = front();
+		const auto slot = controller_slot(frame, id);
+		if (slot >= max_controllers || size_t(button) >= SDL_CONTROLLER_BUTTON_MAX) return 0;
+		return frame.buttons[slot][button];
+	}
+
+	///The two sets of arrays
+	std::array<Frame, 2> frames_;
+	///Index of the frame read by the queries
+	size_t front_ = 0;
+	///Written for keys and buttons out of the arrays
+	Uint8 dummy_ = 0;
+};
+
+} // namespace sdl
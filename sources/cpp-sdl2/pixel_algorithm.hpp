@@ -0,0 +1,187 @@
+#pragma once
+
+#include "exception.hpp"
+#include "pixel_view.hpp"
+#include "surface.hpp"
+#include "system.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace sdl
+{
+namespace details
+{
+// The per-row loops are the same for every instruction set: they are duplicated so that each copy
+// gets compiled (and auto-vectorized) for its own target, with the user's function inlined in it.
+
+template<typename T, typename F>
+void transform_row(T const* __restrict src, T* __restrict dst, int width, F& f)
+{
+	for (int x = 0; x < width; ++x) dst[x] = f(src[x]);
+}
+
+template<typename T, typename F>
+void for_each_row(T* row, int width, F& f)
+{
+	for (int x = 0; x < width; ++x) f(row[x]);
+}
+
+#ifdef CPP_SDL2_X86_DISPATCH
+template<typename T, typename F>
+CPP_SDL2_TARGET("sse4.1")
+void transform_row_sse41(T const* __restrict src, T* __restrict dst, int width, F& f)
+{
+	for (int x = 0; x < width; ++x) dst[x] = f(src[x]);
+}
+
+template<typename T, typename F>
+CPP_SDL2_TARGET("avx2")
+void transform_row_avx2(T const* __restrict src, T* __restrict dst, int width, F& f)
+{
+	for (int x = 0; x < width; ++x) dst[x] = f(src[x]);
+}
+
+template<typename T, typename F>
+CPP_SDL2_TARGET("sse4.1")
+void for_each_row_sse41(T* row, int width, F& f)
+{
+	for (int x = 0; x < width; ++x) f(row[x]);
+}
+
+template<typename T, typename F>
+CPP_SDL2_TARGET("avx2")
+void for_each_row_avx2(T* row, int width, F& f)
+{
+	for (int x = 0; x < width; ++x) f(row[x]);
+}
+#endif
+
+///Apply f to rows [y0, y1) with the kernel matching the running CPU
+template<Uint32 Format, typename F>
+void transform_rows(PixelView<Format> const& src, PixelView<Format> const& dst, F& f, int y0, int y1)
+{
+	using T = typename PixelView<Format>::value_type;
+
+	auto kernel = &transform_row<T, F>;
+#ifdef CPP_SDL2_X86_DISPATCH
+	switch (simd_level())
+	{
+	case SimdLevel::avx2: kernel = &transform_row_avx2<T, F>; break;
+	case SimdLevel::sse41: kernel = &transform_row_sse41<T, F>; break;
+	case SimdLevel::scalar: break;
+	}
+#endif
+
+	for (int y = y0; y < y1; ++y) kernel(src.row_ptr(y), dst.row_ptr(y), src.width(), f);
+}
+
+///Call f on each pixel of rows [y0, y1) with the kernel matching the running CPU
+template<Uint32 Format, typename F>
+void for_each_rows(PixelView<Format> const& view, F& f, int y0, int y1)
+{
+	using T = typename PixelView<Format>::value_type;
+
+	auto kernel = &for_each_row<T, F>;
+#ifdef CPP_SDL2_X86_DISPATCH
+	switch (simd_level())
+	{
+	case SimdLevel::avx2: kernel = &for_each_row_avx2<T, F>; break;
+	case SimdLevel::sse41: kernel = &for_each_row_sse41<T, F>; break;
+	case SimdLevel::scalar: break;
+	}
+#endif
+
+	for (int y = y0; y < y1; ++y) kernel(view.row_ptr(y), view.width(), f);
+}
+} // namespace details
+
+///\brief Call `f(pixel&)` on each pixel of the view.
+///
+///Rows are split across the pool, so f is called concurrently from several threads and must not
+///modify shared state.
+template<Uint32 Format, typename F>
+void pixel_for_each(PixelView<Format> const& view, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	using T = typename PixelView<Format>::value_type;
+	pool.parallel_for(
+		0,
+		view.height(),
+		[&](int y0, int y1) { details::for_each_rows(view, f, y0, y1); },
+		details::min_rows_per_chunk(view.width() * int(sizeof(T))));
+}
+
+///\brief Replace each pixel of the view by `f(pixel)`.
+///
+///Rows are split across the pool, so f is called concurrently from several threads and must not
+///modify shared state.
+template<Uint32 Format, typename F>
+void pixel_transform(PixelView<Format> const& view, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	using T = typename PixelView<Format>::value_type;
+	pixel_for_each(view, [f](T& p) mutable { p = f(p); }, pool);
+}
+
+///\brief Store `f(pixel)` for each pixel of src into the same location of dst.
+///
+///src and dst must either be the same view, or not overlap at all. Rows are split across the
+///pool, so f is called concurrently from several threads and must not modify shared state.
+template<Uint32 Format, typename F>
+void pixel_transform(
+	PixelView<Format> const& src,
+	PixelView<Format> const& dst,
+	F						 f,
+	ThreadPool&				 pool = ThreadPool::shared())
+{
+	if (src.size() != dst.size())
+	{
+		SDL_SetError("pixel_transform: source and destination sizes differ");
+		throw Exception{"pixel_transform"};
+	}
+
+	if (src.row_ptr(0) == dst.row_ptr(0) && src.pitch() == dst.pitch())
+	{
+		pixel_transform(dst, std::move(f), pool);
+		return;
+	}
+
+	using T = typename PixelView<Format>::value_type;
+	pool.parallel_for(
+		0,
+		src.height(),
+		[&](int y0, int y1) { details::transform_rows(src, dst, f, y0, y1); },
+		details::min_rows_per_chunk(src.width() * int(sizeof(T))));
+}
+
+///Replace each pixel of the surface by `f(pixel)`. Throws if the surface isn't in the given format
+template<Uint32 Format, typename F>
+void pixel_transform(Surface& surface, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	auto lock = surface.lock();
+	pixel_transform(lock.view<Format>(), std::move(f), pool);
+}
+
+///Replace each locked pixel of a texture by `f(pixel)`. Throws if the texture isn't in the given format
+template<Uint32 Format, typename F>
+void pixel_transform(Texture::Lock const& lock, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	pixel_transform(lock.view<Format>(), std::move(f), pool);
+}
+
+///Call `f(pixel&)` on each pixel of the surface. Throws if the surface isn't in the given format
+template<Uint32 Format, typename F>
+void pixel_for_each(Surface& surface, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	auto lock = surface.lock();
+	pixel_for_each(lock.view<Format>(), std::move(f), pool);
+}
+
+///Call `f(pixel&)` on each locked pixel of a texture. Throws if the texture isn't in the given format
+template<Uint32 Format, typename F>
+void pixel_for_each(Texture::Lock const& lock, F f, ThreadPool& pool = ThreadPool::shared())
+{
+	pixel_for_each(lock.view<Format>(), std::move(f), pool);
+}
+
+} // namespace sdl
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "exception.hpp"
+#include "system.hpp"
+
+#include <SDL_endian.h>
+#include <SDL_pixels.h>
+
+#ifdef CPP_SDL2_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+namespace sdl
+{
+namespace details
+{
+///Position of each channel inside a pixel, in bytes. Channels that aren't stored are set to -1
+struct ByteLayout
+{
+	int bytes = 0;
+	int r	  = -1;
+	int g	  = -1;
+	int b	  = -1;
+	int a	  = -1;
+};
+
+///Get the byte layout of the formats handled by the fast converters, or bytes == 0 for others
+constexpr ByteLayout byte_layout(Uint32 format)
+{
+	// Packed formats are stored as native endian Uint32, array formats byte after byte
+	constexpr bool le = SDL_BYTEORDER == SDL_LIL_ENDIAN;
+
+	switch (format)
+	{
+	case SDL_PIXELFORMAT_ARGB8888: return le ? ByteLayout{4, 2, 1, 0, 3} : ByteLayout{4, 1, 2, 3, 0};
+	case SDL_PIXELFORMAT_ABGR8888: return le ? ByteLayout{4, 0, 1, 2, 3} : ByteLayout{4, 3, 2, 1, 0};
+	case SDL_PIXELFORMAT_RGBA8888: return le ? ByteLayout{4, 3, 2, 1, 0} : ByteLayout{4, 0, 1, 2, 3};
+	case SDL_PIXELFORMAT_BGRA8888: return le ? ByteLayout{4, 1, 2, 3, 0} : ByteLayout{4, 2, 1, 0, 3};
+	case SDL_PIXELFORMAT_RGB888: return le ? ByteLayout{4, 2, 1, 0} : ByteLayout{4, 1, 2, 3};
+	case SDL_PIXELFORMAT_BGR888: return le ? ByteLayout{4, 0, 1, 2} : ByteLayout{4, 3, 2, 1};
+	case SDL_PIXELFORMAT_RGB24: return ByteLayout{3, 0, 1, 2};
+	case SDL_PIXELFORMAT_BGR24: return ByteLayout{3, 2, 1, 0};
+	default: return ByteLayout{};
+	}
+}
+
+///\brief Byte permutation turning pixels of one format into another.
+///
+///Each destination byte is either copied from a source byte, or set to a constant: 0xFF for an
+///alpha channel missing from the source, 0 for padding bytes (the same values SDL's blitter uses).
+struct Shuffle
+{
+	int src_bytes = 0;
+	int dst_bytes = 0;
+	///Source byte of each destination byte, or -1 to use fill
+	std::array<int, 4> index = {{-1, -1, -1, -1}};
+	///Value of the destination bytes that aren't copied
+	std::array<Uint8, 4> fill = {};
+
+	///Number of pixels converted by one 16 byte step of the SIMD kernels
+	int step = 0;
+	///pshufb control for one step. 0x80 zeroes the byte
+	alignas(16) std::array<Uint8, 16> simd_index = {};
+	///Bytes or-ed after the shuffle
+	alignas(16) std::array<Uint8, 16> simd_fill = {};
+
+	///Return true if these formats have a fast path
+	bool valid() const { return src_bytes != 0; }
+
+	///Return true if the permutation is a plain copy
+	bool identity() const
+	{
+		if (src_bytes != dst_bytes) return false;
+		for (int i = 0; i < dst_bytes; ++i)
+			if (index[i] != i) return false;
+		return true;
+	}
+};
+
+///Build the permutation from src_format to dst_format. The result isn't valid() if either format
+///has no fast path
+inline Shuffle make_shuffle(Uint32 src_format, Uint32 dst_format)
+{
+	const auto src = byte_layout(src_format);
+	const auto dst = byte_layout(dst_format);
+
+	Shuffle s;
+	if (!src.bytes || !dst.bytes) return s;
+
+	s.src_bytes	   = src.bytes;
+	s.dst_bytes	   = dst.bytes;
+	s.index[dst.r] = src.r;
+	s.index[dst.g] = src.g;
+	s.index[dst.b] = src.b;
+	if (dst.a >= 0)
+	{
+		s.index[dst.a] = src.a;
+		if (src.a < 0) s.fill[dst.a] = 0xFF;
+	}
+
+	// A step reads and writes 16 bytes. 24 to 24 bit converts 5 pixels, and copies the last byte
+	// through so that it stays correct when converting in place. Other bytes past the converted
+	// pixels are garbage, overwritten by the next step or by the scalar tail.
+	s.step = src.bytes == 3 && dst.bytes == 3 ? 5 : 4;
+	for (int i = 0; i < 16; ++i)
+	{
+		const int p = i / s.dst_bytes;
+		const int c = i % s.dst_bytes;
+
+		if (p >= s.step)
+			s.simd_index[i] = s.src_bytes == 3 && s.dst_bytes == 3 ? Uint8(i) : 0x80;
+		else if (s.index[c] < 0)
+			s.simd_index[i] = 0x80;
+		else
+			s.simd_index[i] = Uint8(p * s.src_bytes + s.index[c]);
+
+		s.simd_fill[i] = p < s.step ? s.fill[c] : 0;
+	}
+
+	return s;
+}
+
+///Convert pixels [x, width) of a row, one at a time
+inline void convert_row_scalar(Shuffle const& s, Uint8 const* src, Uint8* dst, int x, int width)
+{
+	src += x * s.src_bytes;
+	dst += x * s.dst_bytes;
+
+	for (; x < width; ++x, src += s.src_bytes, dst += s.dst_bytes)
+	{
+		// Read the whole pixel first, src and dst may be the same row
+		Uint8 px[4];
+		std::memcpy(px, src, size_t(s.src_bytes));
+		for (int i = 0; i < s.dst_bytes; ++i) dst[i] = s.index[i] < 0 ? s.fill[i] : px[s.index[i]];
+	}
+}
+
+#ifdef CPP_SDL2_X86_DISPATCH
+///Convert the start of a row 16 bytes at a time. Return the number of pixels converted
+CPP_SDL2_TARGET("sse4.1")
+inline int convert_row_sse41(Shuffle const& s, Uint8 const* src, Uint8* dst, int width)
+{
+	const auto index = _mm_load_si128(reinterpret_cast<__m128i const*>(s.simd_index.data()));
+	const auto fill	 = _mm_load_si128(reinterpret_cast<__m128i const*>(s.simd_fill.data()));
+
+	// Every 16 byte load and store must stay inside the row
+	const auto src_end = std::ptrdiff_t(width) * s.src_bytes - 16;
+	const auto dst_end = std::ptrdiff_t(width) * s.dst_bytes - 16;
+
+	int x = 0;
+	for (; x * s.src_bytes <= src_end && x * s.dst_bytes <= dst_end; x += s.step)
+	{
+		const auto in  = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + x * s.src_bytes));
+		const auto out = _mm_or_si128(_mm_shuffle_epi8(in, index), fill);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * s.dst_bytes), out);
+	}
+	return x;
+}
+
+///Convert the start of a row 32 bytes at a time. Return the number of pixels converted
+CPP_SDL2_TARGET("avx2")
+inline int convert_row_avx2(Shuffle const& s, Uint8 const* src, Uint8* dst, int width)
+{
+	// pshufb doesn't cross 128 bit lanes, which only 4 to 4 byte permutations can live with
+	if (s.src_bytes != 4 || s.dst_bytes != 4) return convert_row_sse41(s, src, dst, width);
+
+	const auto index = _mm256_broadcastsi128_si256(
+		_mm_load_si128(reinterpret_cast<__m128i const*>(s.simd_index.data())));
+	const auto fill = _mm256_broadcastsi128_si256(
+		_mm_load_si128(reinterpret_cast<__m128i const*>(s.simd_fill.data())));
+
+	int x = 0;
+	for (; x + 8 <= width; x += 8)
+	{
+		const auto in  = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + x * 4));
+		const auto out = _mm256_or_si256(_mm256_shuffle_epi8(in, index), fill);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), out);
+	}
+	return x;
+}
+#endif
+
+///Convert rows [y0, y1) of a block of pixels with the kernel matching the running CPU
+inline void convert_rows(
+	Shuffle const& s,
+	Uint8 const*   src,
+	int			   src_pitch,
+	Uint8*		   dst,
+	int			   dst_pitch,
+	int			   width,
+	int			   y0,
+	int			   y1)
+{
+	for (int y = y0; y < y1; ++y)
+	{
+		auto src_row = src + std::ptrdiff_t(y) * src_pitch;
+		auto dst_row = dst + std::ptrdiff_t(y) * dst_pitch;
+
+		if (s.identity())
+		{
+			if (src_row != dst_row) std::memmove(dst_row, src_row, size_t(width) * s.dst_bytes);
+			continue;
+		}
+
+		int x = 0;
+#ifdef CPP_SDL2_X86_DISPATCH
+		switch (simd_level())
+		{
+		case SimdLevel::avx2: x = convert_row_avx2(s, src_row, dst_row, width); break;
+		case SimdLevel::sse41: x = convert_row_sse41(s, src_row, dst_row, width); break;
+		case SimdLevel::scalar: break;
+		}
+#endif
+		convert_row_scalar(s, src_row, dst_row, x, width);
+	}
+}
+} // namespace details
+
+///\brief Return true if convert_pixels() has a vectorized path between these formats.
+///
+///Fast paths exist between any two of ARGB8888, ABGR8888, RGBA8888, BGRA8888, RGB888, BGR888,
+///RGB24 and BGR24.
+inline bool has_fast_conversion(Uint32 src_format, Uint32 dst_format)
+{
+	return details::byte_layout(src_format).bytes && details::byte_layout(dst_format).bytes;
+}
+
+///\brief Convert a block of pixels from one format to another, like SDL_ConvertPixels().
+///
+///Formats with a fast path (see has_fast_conversion()) are converted with SIMD code, and can be
+///converted in place when they have the same size. Others go through SDL_ConvertPixels().
+inline void convert_pixels(
+	int			width,
+	int			height,
+	Uint32		src_format,
+	void const* src,
+	int			src_pitch,
+	Uint32		dst_format,
+	void*		dst,
+	int			dst_pitch)
+{
+	const auto shuffle = details::make_shuffle(src_format, dst_format);
+	if (!shuffle.valid())
+	{
+		if (SDL_ConvertPixels(width, height, src_format, src, src_pitch, dst_format, dst, dst_pitch)
+			!= 0)
+		{
+			throw Exception{"SDL_ConvertPixels"};
+		}
+		return;
+	}
+
+	details::convert_rows(
+		shuffle,
+		static_cast<Uint8 const*>(src),
+		src_pitch,
+		static_cast<Uint8*>(dst),
+		dst_pitch,
+		width,
+		0,
+		height);
+}
+
+} // namespace sdl
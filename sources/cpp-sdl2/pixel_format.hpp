@@ -0,0 +1,123 @@
+#pragma once
+
+#include "exception.hpp"
+
+#include <SDL_pixels.h>
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace sdl
+{
+namespace details
+{
+///\brief Process-wide cache of SDL_PixelFormat objects, one per SDL_PIXELFORMAT_* value.
+///
+///Formats are allocated the first time they are requested, and are kept until the process exits,
+///so pointers handed out by this cache never dangle. Lookups first go through a small per-thread
+///cache, and only take the cache lock on a miss.
+class FormatCache
+{
+public:
+	using Handle = std::shared_ptr<SDL_PixelFormat const>;
+
+	///Get the cache instance
+	static FormatCache& instance()
+	{
+		static FormatCache cache;
+		return cache;
+	}
+
+	///Get the shared handle of a format
+	Handle const& handle(Uint32 format)
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+
+		auto& entry = entries_[format];
+		if (!entry)
+		{
+			auto f = SDL_AllocFormat(format);
+			if (!f) throw Exception{"SDL_AllocFormat"};
+			entry = Handle{f, [](SDL_PixelFormat const* p) {
+							   SDL_FreeFormat(const_cast<SDL_PixelFormat*>(p));
+						   }};
+		}
+		return entry;
+	}
+
+	///Get a format without touching its reference count
+	SDL_PixelFormat const& get(Uint32 format)
+	{
+		struct Recent
+		{
+			Uint32				   format = SDL_PIXELFORMAT_UNKNOWN;
+			SDL_PixelFormat const* ptr	  = nullptr;
+		};
+
+		thread_local std::array<Recent, 4> recent;
+		thread_local size_t				   next = 0;
+
+		for (auto const& r : recent)
+			if (r.ptr && r.format == format) return *r.ptr;
+
+		auto ptr		= handle(format).get();
+		recent[next]	= {format, ptr};
+		next			= (next + 1) % recent.size();
+		return *ptr;
+	}
+
+private:
+	FormatCache() = default;
+
+	///Protect entries_
+	std::mutex mutex_;
+	///Allocated formats. Entries are never removed
+	std::unordered_map<Uint32, Handle> entries_;
+};
+} // namespace details
+
+///\brief Shared handle to a cached SDL_PixelFormat.
+///
+///Handles to the same SDL_PIXELFORMAT_* value all point to the same SDL_PixelFormat, allocated once
+///for the whole process. Copying a handle only bumps a reference count. The format is shared: do
+///not modify it (e.g. by setting a palette on it).
+class PixelFormat
+{
+public:
+	///Get the handle of the given SDL_PIXELFORMAT_* value
+	explicit PixelFormat(Uint32 format) : format_{details::FormatCache::instance().handle(format)}
+	{
+	}
+
+	///Get a reference to the cached format without creating a handle. The reference stays valid
+	///until the process exits
+	static SDL_PixelFormat const& get(Uint32 format)
+	{
+		return details::FormatCache::instance().get(format);
+	}
+
+	///Get a pointer to the C SDL_PixelFormat
+	SDL_PixelFormat const* ptr() const { return format_.get(); }
+
+	///Implicit conversion to the C SDL_PixelFormat
+	operator SDL_PixelFormat const&() const { return *format_; }
+
+	///Access members of the C SDL_PixelFormat
+	SDL_PixelFormat const* operator->() const { return format_.get(); }
+
+	///Get the SDL_PIXELFORMAT_* value of this format
+	Uint32 format() const { return format_->format; }
+
+	///Return true if both handles refer to the same format
+	bool operator==(PixelFormat const& other) const { return format_ == other.format_; }
+	///Return true if handles refer to different formats
+	bool operator!=(PixelFormat const& other) const { return format_ != other.format_; }
+
+private:
+	///Shared pointer to the cached format
+	details::FormatCache::Handle format_;
+};
+
+} // namespace sdl
@@ -0,0 +1,354 @@
+#pragma once
+
+#include "color.hpp"
+#include "rect.hpp"
+#include "vec2.hpp"
+
+#include <SDL_pixels.h>
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+namespace sdl
+{
+namespace details
+{
+///Channel masks of a packed pixel format
+struct ChannelMasks
+{
+	Uint32 r, g, b, a;
+};
+
+///Compile-time equivalent of SDL_PixelFormatEnumToMasks() for packed formats
+constexpr ChannelMasks packed_masks(Uint32 format)
+{
+	Uint32 m[4] = {0, 0, 0, 0};
+	switch (SDL_PIXELLAYOUT(format))
+	{
+	case SDL_PACKEDLAYOUT_332: m[1] = 0xE0, m[2] = 0x1C, m[3] = 0x03; break;
+	case SDL_PACKEDLAYOUT_4444: m[0] = 0xF000, m[1] = 0x0F00, m[2] = 0x00F0, m[3] = 0x000F; break;
+	case SDL_PACKEDLAYOUT_1555: m[0] = 0x8000, m[1] = 0x7C00, m[2] = 0x03E0, m[3] = 0x001F; break;
+	case SDL_PACKEDLAYOUT_5551: m[0] = 0xF800, m[1] = 0x07C0, m[2] = 0x003E, m[3] = 0x0001; break;
+	case SDL_PACKEDLAYOUT_565: m[1] = 0xF800, m[2] = 0x07E0, m[3] = 0x001F; break;
+	case SDL_PACKEDLAYOUT_8888:
+		m[0] = 0xFF000000, m[1] = 0x00FF0000, m[2] = 0x0000FF00, m[3] = 0x000000FF;
+		break;
+	case SDL_PACKEDLAYOUT_2101010:
+		m[0] = 0xC0000000, m[1] = 0x3FF00000, m[2] = 0x000FFC00, m[3] = 0x000003FF;
+		break;
+	case SDL_PACKEDLAYOUT_1010102:
+		m[0] = 0xFFC00000, m[1] = 0x003FF000, m[2] = 0x00000FFC, m[3] = 0x00000003;
+		break;
+	default: break;
+	}
+
+	switch (SDL_PIXELORDER(format))
+	{
+	case SDL_PACKEDORDER_XRGB: return {m[1], m[2], m[3], 0};
+	case SDL_PACKEDORDER_RGBX: return {m[0], m[1], m[2], 0};
+	case SDL_PACKEDORDER_ARGB: return {m[1], m[2], m[3], m[0]};
+	case SDL_PACKEDORDER_RGBA: return {m[0], m[1], m[2], m[3]};
+	case SDL_PACKEDORDER_XBGR: return {m[3], m[2], m[1], 0};
+	case SDL_PACKEDORDER_BGRX: return {m[2], m[1], m[0], 0};
+	case SDL_PACKEDORDER_ABGR: return {m[3], m[2], m[1], m[0]};
+	case SDL_PACKEDORDER_BGRA: return {m[2], m[1], m[0], m[3]};
+	default: return {0, 0, 0, 0};
+	}
+}
+
+///Position of the lowest bit set in mask
+constexpr int mask_shift(Uint32 mask)
+{
+	if (mask == 0) return 0;
+	int shift = 0;
+	for (; (mask & 1) == 0; mask >>= 1) ++shift;
+	return shift;
+}
+
+///Number of contiguous bits set in mask
+constexpr int mask_bits(Uint32 mask)
+{
+	int bits = 0;
+	for (mask >>= mask_shift(mask); mask & 1; mask >>= 1) ++bits;
+	return bits;
+}
+
+///Return true if the format is one that PixelView can represent
+constexpr bool is_viewable_format(Uint32 format)
+{
+	if (SDL_ISPIXELFORMAT_PACKED(format)) return true;
+
+	return SDL_ISPIXELFORMAT_ARRAY(format) && SDL_PIXELTYPE(format) == SDL_PIXELTYPE_ARRAYU8
+		   && SDL_BYTESPERPIXEL(format) == 3;
+}
+
+///Storage type of one pixel of the given size
+template<int BytesPerPixel>
+struct PixelStorage;
+
+template<>
+struct PixelStorage<1>
+{
+	using type = Uint8;
+};
+
+template<>
+struct PixelStorage<2>
+{
+	using type = Uint16;
+};
+
+template<>
+struct PixelStorage<3>
+{
+	using type = std::array<Uint8, 3>;
+};
+
+template<>
+struct PixelStorage<4>
+{
+	using type = Uint32;
+};
+
+///Expand a channel of Bits bits to a full byte, the same way SDL_GetRGBA() does
+template<int Bits>
+constexpr Uint8 expand_channel(Uint32 value)
+{
+	if constexpr (Bits >= 8)
+	{
+		return static_cast<Uint8>(value >> (Bits - 8));
+	}
+	else
+	{
+		Uint32 out	  = 0;
+		int	   filled = 0;
+		for (; filled < 8; filled += Bits) out = (out << Bits) | value;
+		return static_cast<Uint8>(out >> (filled - 8));
+	}
+}
+
+///Narrow a byte to a channel of Bits bits, the same way SDL_MapRGBA() does
+template<int Bits>
+constexpr Uint32 narrow_channel(Uint8 value)
+{
+	if constexpr (Bits >= 8)
+		return (Uint32(value) << (Bits - 8)) | (Uint32(value) >> (16 - Bits));
+	else
+		return Uint32(value) >> (8 - Bits);
+}
+
+} // namespace details
+
+///\brief Compile-time description of a pixel format.
+///
+///Masks, shifts and storage type are all constant expressions, so converting between a raw pixel
+///and an sdl::Color compiles down to a few shifts and masks instead of going through
+///SDL_GetRGBA()/SDL_MapRGBA()
+template<Uint32 Format>
+struct PixelTraits
+{
+	static_assert(
+		details::is_viewable_format(Format),
+		"PixelTraits only supports packed formats and 24 bit byte array formats");
+
+	///The SDL_PIXELFORMAT_* value described by this object
+	static constexpr Uint32 format = Format;
+	///Size of one pixel in memory
+	static constexpr int bytes_per_pixel = SDL_BYTESPERPIXEL(Format);
+	///Type used to store one pixel in memory
+	using value_type = typename details::PixelStorage<bytes_per_pixel>::type;
+
+	///True if this format is stored as an integer in native byte order
+	static constexpr bool is_packed = SDL_ISPIXELFORMAT_PACKED(Format);
+	///True if this format has an alpha channel
+	static constexpr bool has_alpha = SDL_ISPIXELFORMAT_ALPHA(Format);
+
+	static constexpr Uint32 rmask = is_packed ? details::packed_masks(Format).r : 0;
+	static constexpr Uint32 gmask = is_packed ? details::packed_masks(Format).g : 0;
+	static constexpr Uint32 bmask = is_packed ? details::packed_masks(Format).b : 0;
+	static constexpr Uint32 amask = is_packed ? details::packed_masks(Format).a : 0;
+
+	static constexpr int rshift = details::mask_shift(rmask);
+	static constexpr int gshift = details::mask_shift(gmask);
+	static constexpr int bshift = details::mask_shift(bmask);
+	static constexpr int ashift = details::mask_shift(amask);
+
+	static constexpr int rbits = details::mask_bits(rmask);
+	static constexpr int gbits = details::mask_bits(gmask);
+	static constexpr int bbits = details::mask_bits(bmask);
+	static constexpr int abits = details::mask_bits(amask);
+
+	///Index of the red byte inside a pixel of a byte array format
+	static constexpr int rindex = SDL_PIXELORDER(Format) == SDL_ARRAYORDER_BGR ? 2 : 0;
+	///Index of the green byte inside a pixel of a byte array format
+	static constexpr int gindex = 1;
+	///Index of the blue byte inside a pixel of a byte array format
+	static constexpr int bindex = SDL_PIXELORDER(Format) == SDL_ARRAYORDER_BGR ? 0 : 2;
+
+	///Get the red channel of a pixel
+	static constexpr Uint8 r(value_type p)
+	{
+		if constexpr (is_packed)
+			return details::expand_channel<rbits>((Uint32(p) & rmask) >> rshift);
+		else
+			return p[rindex];
+	}
+
+	///Get the green channel of a pixel
+	static constexpr Uint8 g(value_type p)
+	{
+		if constexpr (is_packed)
+			return details::expand_channel<gbits>((Uint32(p) & gmask) >> gshift);
+		else
+			return p[gindex];
+	}
+
+	///Get the blue channel of a pixel
+	static constexpr Uint8 b(value_type p)
+	{
+		if constexpr (is_packed)
+			return details::expand_channel<bbits>((Uint32(p) & bmask) >> bshift);
+		else
+			return p[bindex];
+	}
+
+	///Get the alpha channel of a pixel. Formats without alpha are fully opaque
+	static constexpr Uint8 a([[maybe_unused]] value_type p)
+	{
+		if constexpr (has_alpha)
+			return details::expand_channel<abits>((Uint32(p) & amask) >> ashift);
+		else
+			return SDL_ALPHA_OPAQUE;
+	}
+
+	///Convert a pixel to a color
+	static constexpr Color to_color(value_type p) { return Color{r(p), g(p), b(p), a(p)}; }
+
+	///Convert a color to a pixel. Alpha is dropped if the format has no alpha channel
+	static constexpr value_type from_color(Color const& c)
+	{
+		if constexpr (is_packed)
+		{
+			Uint32 raw = details::narrow_channel<rbits>(c.r) << rshift
+						 | details::narrow_channel<gbits>(c.g) << gshift
+						 | details::narrow_channel<bbits>(c.b) << bshift;
+			if constexpr (has_alpha) raw |= details::narrow_channel<abits>(c.a) << ashift;
+			return static_cast<value_type>(raw);
+		}
+		else
+		{
+			value_type p{};
+			p[rindex] = c.r;
+			p[gindex] = c.g;
+			p[bindex] = c.b;
+			return p;
+		}
+	}
+};
+
+///\brief Typed 2D view over locked pixels of a known format.
+///
+///This doesn't own anything, and is only valid as long as the lock it has been created from.
+///Each row is a contiguous array of PixelTraits<Format>::value_type, so loops over rows are plain
+///loads and stores that the compiler is free to vectorize.
+template<Uint32 Format>
+class PixelView
+{
+public:
+	using traits	 = PixelTraits<Format>;
+	using value_type = typename traits::value_type;
+	using iterator	 = value_type*;
+
+	static_assert(sizeof(value_type) == traits::bytes_per_pixel, "pixel storage must be packed");
+
+	///A row of pixels, contiguous in memory
+	class Row
+	{
+	public:
+		constexpr Row(value_type* data, int width) : data_{data}, width_{width} {}
+
+		///Pointer to the first pixel of the row
+		constexpr value_type* data() const { return data_; }
+		///Number of pixels in the row
+		constexpr int size() const { return width_; }
+
+		constexpr iterator begin() const { return data_; }
+		constexpr iterator end() const { return data_ + width_; }
+
+		///Get the pixel at the given column
+		constexpr value_type& operator[](int x) const { return data_[x]; }
+
+	private:
+		value_type* data_;
+		int			width_;
+	};
+
+	///Create a view over raw pixels
+	///\param pixels pointer to the first pixel
+	///\param width number of pixels per row
+	///\param height number of rows
+	///\param pitch distance between two rows, in bytes
+	constexpr PixelView(void* pixels, int width, int height, int pitch)
+		: pixels_{static_cast<Uint8*>(pixels)}, width_{width}, height_{height}, pitch_{pitch}
+	{
+	}
+
+	///Get the number of pixels per row
+	constexpr int width() const { return width_; }
+	///Get the number of rows
+	constexpr int height() const { return height_; }
+	///Get the size of the view
+	constexpr Vec2i size() const { return Vec2i{width_, height_}; }
+	///Get the distance between two rows, in bytes
+	constexpr int pitch() const { return pitch_; }
+
+	///Return true if there is no padding between rows
+	constexpr bool is_contiguous() const { return pitch_ == width_ * traits::bytes_per_pixel; }
+
+	///Get a pointer to the first pixel of a row
+	constexpr value_type* row_ptr(int y) const
+	{
+		return reinterpret_cast<value_type*>(pixels_ + std::ptrdiff_t(y) * pitch_);
+	}
+
+	///Get a row
+	constexpr Row row(int y) const { return Row{row_ptr(y), width_}; }
+	///Get a row via operator[]
+	constexpr Row operator[](int y) const { return row(y); }
+
+	///Get the pixel at the given location
+	constexpr value_type& at(int x, int y) const { return row_ptr(y)[x]; }
+	///Get the pixel at the given location
+	constexpr value_type& at(Vec2i const& pos) const { return at(pos.x, pos.y); }
+
+	///Get the color of the pixel at the given location
+	constexpr Color color(int x, int y) const { return traits::to_color(at(x, y)); }
+	///Set the color of the pixel at the given location
+	constexpr void set_color(int x, int y, Color const& c) const
+	{
+		at(x, y) = traits::from_color(c);
+	}
+
+	///Get a view over a region of this one. The region must be inside the view
+	constexpr PixelView subview(Rect const& r) const
+	{
+		return PixelView{
+			pixels_ + std::ptrdiff_t(r.y) * pitch_ + std::ptrdiff_t(r.x) * traits::bytes_per_pixel,
+			r.w,
+			r.h,
+			pitch_};
+	}
+
+private:
+	///Pointer to the first pixel
+	Uint8* pixels_;
+	///Pixels per row
+	int width_;
+	///Number of rows
+	int height_;
+	///Bytes between two rows
+	int pitch_;
+};
+
+} // namespace sdl
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <SDL_rect.h>
+#include <SDL_version.h>
 #include <algorithm>
 
 #include "vec2.hpp"
@@ -154,4 +155,67 @@ public:
 	}
 };
 
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+///sdl::FRect, C++ wrapping of SDL_FRect, for subpixel precise drawing
+class FRect : public SDL_FRect
+{
+public:
+	///Construct a FRect initialized at 0
+	constexpr FRect() : SDL_FRect{0, 0, 0, 0} {}
+
+	///Construct a FRect with the given dimensions
+	///\param x Position on X axis
+	///\param y Position on Y axis
+	///\param w Size on X axis
+	///\param h Size on Y axis
+	constexpr FRect(float x, float y, float w, float h) : SDL_FRect{x, y, w, h} {}
+
+	///Construct a FRect with the given dimensions
+	///\param corner X/Y position on screen as a 2D vector
+	///\param size X/Y size on screen as a 2D vector
+	constexpr FRect(Vec2f const& corner, Vec2f const& size)
+		: SDL_FRect{corner.x, corner.y, size.x, size.y}
+	{
+	}
+
+	///Copy a FRect
+	constexpr FRect(SDL_FRect const& r) : SDL_FRect{r} {}
+
+	///Convert a Rect
+	explicit constexpr FRect(SDL_Rect const& r)
+		: SDL_FRect{float(r.x), float(r.y), float(r.w), float(r.h)}
+	{
+	}
+
+	///Returns true if the two rect are the same
+	constexpr bool operator==(FRect const& o) const
+	{
+		return x == o.x && y == o.y && w == o.w && h == o.h;
+	}
+
+	///Return the 'min X' position of the FRect
+	constexpr float x1() const { return x; }
+	///Return the 'max X' position of the FRect
+	constexpr float x2() const { return x + w; }
+	///Return the 'min Y' position of the FRect
+	constexpr float y1() const { return y; }
+	///Return the 'max Y' position of the FRect
+	constexpr float y2() const { return y + h; }
+
+	///Get the size of the FRect
+	constexpr Vec2f size() const { return Vec2f{w, h}; }
+	///Get the center of the FRect
+	constexpr Vec2f center() const { return Vec2f{x + w / 2, y + h / 2}; }
+
+	///Return true if this FRect is empty
+	constexpr bool is_empty() const { return w <= 0 || h <= 0; }
+
+	///Return true if this rect contains the given point
+	constexpr bool contains(Vec2f const& point) const
+	{
+		return point.x >= x1() && point.x < x2() && point.y >= y1() && point.y < y2();
+	}
+};
+#endif
+
 } // namespace sdl
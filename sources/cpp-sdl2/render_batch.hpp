@@ -0,0 +1,577 @@
+#pragma once
+
+#include "color.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "renderer.hpp"
+#include "texture.hpp"
+#include "vec2.hpp"
+
+#include <SDL_render.h>
+#include <SDL_version.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace sdl
+{
+///\brief Recorder of 2D draws, that replays them on a renderer with as few SDL calls as possible.
+///
+///Draws are queued instead of being sent to the renderer. Each one joins a group of draws that
+///share the same texture, blend mode and clip rect: the most recent such group among the last
+///lookback ones, if no group recorded after it overlaps the draw, so that the picture is the same
+///as if everything was drawn in order. flush() then draws every group in turn. Since SDL 2.0.18,
+///rects and texture copies are drawn with one SDL_RenderGeometry() call per group, the draw color
+///being carried by the vertices. Before that, a group still costs a single state change, and its
+///rects are drawn with SDL_RenderFillRects() and its copies with SDL_RenderCopy().
+class RenderBatch
+{
+public:
+	///Number of groups looked at, from the most recent one, to find where a draw goes
+	static constexpr size_t lookback = 32;
+
+	///Create a batch recording draws for a renderer, starting with its draw color, blend mode and
+	///clip rect
+	explicit RenderBatch(SDL_Renderer* renderer) : renderer_{renderer}
+	{
+		const auto s = save_state();
+		color_		 = s.color;
+		blend_		 = s.blend;
+		if (s.clip) set_cliprect(s.cliprect);
+	}
+
+	///Create a batch recording draws for a renderer
+	explicit RenderBatch(Renderer const& renderer) : RenderBatch{renderer.ptr()} {}
+
+	///Get the renderer draws are flushed to
+	SDL_Renderer* renderer() const { return renderer_; }
+
+	///Get the color used by the draws recorded next
+	Color const& drawcolor() const { return color_; }
+	///Set the color used by the draws recorded next
+	void set_drawcolor(Color const& c) { color_ = c; }
+
+	///Get the blend mode used by the draws recorded next, texture copies excepted
+	SDL_BlendMode blendmode() const { return blend_; }
+	///Set the blend mode used by the draws recorded next, texture copies excepted
+	void set_blendmode(SDL_BlendMode mode) { blend_ = mode; }
+
+	///Clip the draws recorded next
+	void set_cliprect(Rect const& r)
+	{
+		if (clips_.empty() || !(clips_.back() == r)) clips_.push_back(r);
+		clip_ = int(clips_.size()) - 1;
+	}
+
+	///Don't clip the draws recorded next
+	void disable_clip() { clip_ = -1; }
+
+	///Fill rectangle
+	void fill_rect(Rect const& rect)
+	{
+		if (rect.w <= 0 || rect.h <= 0) return;
+		push_quad(group_for(Kind::quads, nullptr, {}, rect), color_, {}, rect);
+	}
+
+	///Fill rectangle with specified color
+	void fill_rect(Rect const& rect, Color const& c)
+	{
+		set_drawcolor(c);
+		fill_rect(rect);
+	}
+
+	///Fill array of rectangles
+	void fill_rects(std::vector<Rect> const& rects)
+	{
+		for (auto const& r : rects) fill_rect(r);
+	}
+
+	///Fill array of rectangles with specified color
+	void fill_rects(std::vector<Rect> const& rects, Color const& c)
+	{
+		set_drawcolor(c);
+		fill_rects(rects);
+	}
+
+	///Draw rectangle, as four one pixel wide rects
+	void draw_rect(Rect const& rect)
+	{
+		if (rect.w <= 0 || rect.h <= 0) return;
+
+		const auto g = group_for(Kind::quads, nullptr, {}, rect);
+		push_quad(g, color_, {}, {rect.x, rect.y, rect.w, 1});
+		if (rect.h > 1) push_quad(g, color_, {}, {rect.x, rect.y + rect.h - 1, rect.w, 1});
+		if (rect.h > 2)
+		{
+			push_quad(g, color_, {}, {rect.x, rect.y + 1, 1, rect.h - 2});
+			if (rect.w > 1)
+				push_quad(g, color_, {}, {rect.x + rect.w - 1, rect.y + 1, 1, rect.h - 2});
+		}
+	}
+
+	///Draw rectangle with specified color
+	void draw_rect(Rect const& rect, Color const& c)
+	{
+		set_drawcolor(c);
+		draw_rect(rect);
+	}
+
+	///Draw array of rectangles
+	void draw_rects(std::vector<Rect> const& rects)
+	{
+		for (auto const& r : rects) draw_rect(r);
+	}
+
+	///Draw array of rectangles with specified color
+	void draw_rects(std::vector<Rect> const& rects, Color const& c)
+	{
+		set_drawcolor(c);
+		draw_rects(rects);
+	}
+
+	///Draw point
+	void draw_point(Vec2i const& point)
+	{
+		const auto g = group_for(Kind::points, nullptr, {}, Rect{point.x, point.y, 1, 1});
+		items_.push_back({g, color_, {}, {point.x, point.y, 1, 1}});
+		++groups_[g].count;
+	}
+
+	///Draw point with specified color
+	void draw_point(Vec2i const& point, Color const& c)
+	{
+		set_drawcolor(c);
+		draw_point(point);
+	}
+
+	///Draw array of points
+	void draw_points(std::vector<Vec2i> const& points)
+	{
+		for (auto const& p : points) draw_point(p);
+	}
+
+	///Draw array of points with specified color
+	void draw_points(std::vector<Vec2i> const& points, Color const& c)
+	{
+		set_drawcolor(c);
+		draw_points(points);
+	}
+
+	///Draw line between two points
+	void draw_line(Vec2i const& pos1, Vec2i const& pos2)
+	{
+		Vec2i const points[] = {pos1, pos2};
+		push_lines(points, 2);
+	}
+
+	///Draw line between two points with specified color
+	void draw_line(Vec2i const& pos1, Vec2i const& pos2, Color const& c)
+	{
+		set_drawcolor(c);
+		draw_line(pos1, pos2);
+	}
+
+	///Draw array of lines
+	void draw_lines(std::vector<Vec2i> const& points) { push_lines(points.data(), points.size()); }
+
+	///Draw array of lines with specified color
+	void draw_lines(std::vector<Vec2i> const& points, Color const& c)
+	{
+		set_drawcolor(c);
+		draw_lines(points);
+	}
+
+	///Copy part of a texture. The blend mode and color and alpha mods of the texture are used, not
+	///the draw state of the batch
+	void render_copy(Texture const& tex, Rect const& source_rect, Rect const& dest_rect)
+	{
+		if (dest_rect.w <= 0 || dest_rect.h <= 0) return;
+		// Vertex colors multiply the texture as its mods would with SDL_RenderCopy(), which
+		// SDL_RenderGeometry() ignores
+		push_quad(
+			group_for(Kind::quads, tex.ptr(), tex.size(), dest_rect),
+			tex.coloralphamod(),
+			source_rect,
+			dest_rect);
+	}
+
+	///Copy a whole texture. The blend mode and color and alpha mods of the texture are used, not
+	///the draw state of the batch
+	void render_copy(Texture const& tex, Rect const& dest_rect)
+	{
+		render_copy(tex, Rect{{0, 0}, tex.size()}, dest_rect);
+	}
+
+	///Get the number of draws recorded
+	size_t size() const { return items_.size(); }
+	///Get the number of groups the recorded draws were sorted in
+	size_t groups() const { return groups_.size(); }
+	///Return true if nothing was recorded
+	bool empty() const { return items_.empty(); }
+
+	///Forget every recorded draw. The draw state is kept
+	void discard()
+	{
+		items_.clear();
+		groups_.clear();
+		if (clip_ >= 0)
+		{
+			const auto clip = clips_[size_t(clip_)];
+			clips_.assign(1, clip);
+			clip_ = 0;
+		}
+		else
+		{
+			clips_.clear();
+		}
+	}
+
+	///\brief Draw everything recorded, and forget it.
+	///
+	///The draw color, blend mode and clip rect of the renderer are restored afterwards.
+	void flush()
+	{
+		if (items_.empty()) return;
+
+		// Sort draws by group, keeping their order inside each group
+		size_t first = 0;
+		for (auto& g : groups_)
+		{
+			g.first = first;
+			first += g.count;
+			g.count = 0;
+		}
+		sorted_.resize(items_.size());
+		for (auto const& item : items_)
+		{
+			auto& g						= groups_[item.group];
+			sorted_[g.first + g.count++] = item;
+		}
+
+		const auto saved = save_state();
+#ifndef CPP_SDL2_DISABLE_EXCEPTIONS
+		try
+		{
+			draw_groups();
+			restore_state(saved);
+		}
+		catch (...)
+		{
+			discard();
+			throw;
+		}
+#else
+		draw_groups();
+		restore_state(saved);
+#endif
+
+		discard();
+	}
+
+private:
+	///What a group draws
+	enum class Kind
+	{
+		quads,
+		points,
+		lines
+	};
+
+	///Draws that can be sent to the renderer together
+	struct Group
+	{
+		Kind		  kind;
+		SDL_Texture*  texture;
+		Vec2i		  texture_size;
+		SDL_BlendMode blend;
+		int			  clip;
+		///Draw color of points and lines. Quads carry their own
+		Color color;
+		///Area covered by the group
+		int x1, y1, x2, y2;
+		///Index of the first draw of the group once sorted, and number of draws
+		size_t first, count;
+	};
+
+	///One recorded draw. A line stores its points in dest, and src.x is 1 if it continues the
+	///previous line
+	struct Item
+	{
+		Uint32	 group;
+		Color	 color;
+		SDL_Rect src;
+		SDL_Rect dst;
+	};
+
+	///Renderer state saved by flush()
+	struct State
+	{
+		Color		  color;
+		SDL_BlendMode blend;
+		bool		  clip;
+		Rect		  cliprect;
+	};
+
+	///Get the group a draw covering bounds joins, and grow it to cover bounds
+	Uint32 group_for(Kind kind, SDL_Texture* texture, Vec2i texture_size, Rect const& bounds)
+	{
+		// The blend mode of a texture copy is the one of the texture, the color of a quad is in
+		// its vertices
+		const auto blend = texture ? SDL_BLENDMODE_NONE : blend_;
+		const auto color = kind == Kind::quads ? Color{} : color_;
+		const auto x1 = bounds.x, y1 = bounds.y, x2 = bounds.x + bounds.w, y2 = bounds.y + bounds.h;
+
+		const auto stop = groups_.size() > lookback ? groups_.size() - lookback : 0;
+		for (auto i = groups_.size(); i-- > stop;)
+		{
+			auto& g = groups_[i];
+			if (g.kind == kind && g.texture == texture && g.blend == blend && g.clip == clip_
+				&& g.color == color)
+			{
+				g.x1 = std::min(g.x1, x1);
+				g.y1 = std::min(g.y1, y1);
+				g.x2 = std::max(g.x2, x2);
+				g.y2 = std::max(g.y2, y2);
+				return Uint32(i);
+			}
+
+			// Drawing before a group we overlap would change the picture
+			if (x1 < g.x2 && g.x1 < x2 && y1 < g.y2 && g.y1 < y2) break;
+		}
+
+		groups_.push_back({kind, texture, texture_size, blend, clip_, color, x1, y1, x2, y2, 0, 0});
+		return Uint32(groups_.size() - 1);
+	}
+
+	///Record a rect in a group. color is the fill color of a rect, or the vertex color of a copy
+	void push_quad(Uint32 group, Color const& color, SDL_Rect const& src, SDL_Rect const& dst)
+	{
+		items_.push_back({group, color, src, dst});
+		++groups_[group].count;
+	}
+
+	///Record connected lines, all in the same group
+	void push_lines(Vec2i const* points, size_t count)
+	{
+		if (count < 2) return;
+
+		auto x1 = points[0].x, y1 = points[0].y, x2 = x1, y2 = y1;
+		for (size_t i = 1; i < count; ++i)
+		{
+			x1 = std::min(x1, points[i].x);
+			y1 = std::min(y1, points[i].y);
+			x2 = std::max(x2, points[i].x);
+			y2 = std::max(y2, points[i].y);
+		}
+
+		const auto g = group_for(Kind::lines, nullptr, {}, Rect{x1, y1, x2 - x1 + 1, y2 - y1 + 1});
+		for (size_t i = 1; i < count; ++i)
+		{
+			const auto& a = points[i - 1];
+			const auto& b = points[i];
+			items_.push_back({g, color_, {i > 1 ? 1 : 0, 0, 0, 0}, {a.x, a.y, b.x, b.y}});
+		}
+		groups_[g].count += count - 1;
+	}
+
+	///Get the renderer state flush() changes
+	State save_state()
+	{
+		State s;
+		if (SDL_GetRenderDrawColor(renderer_, &s.color.r, &s.color.g, &s.color.b, &s.color.a) != 0)
+			throw Exception{"SDL_GetRenderDrawColor"};
+		if (SDL_GetRenderDrawBlendMode(renderer_, &s.blend) != 0)
+			throw Exception{"SDL_GetRenderDrawBlendMode"};
+		s.clip = SDL_RenderIsClipEnabled(renderer_);
+		SDL_RenderGetClipRect(renderer_, &s.cliprect);
+
+		applied_color_ = s.color;
+		applied_blend_ = s.blend;
+		applied_clip_  = -2;
+		return s;
+	}
+
+	///Put back the renderer state saved by save_state()
+	void restore_state(State const& s)
+	{
+		set_color(s.color);
+		set_blend(s.blend);
+		if (SDL_RenderSetClipRect(renderer_, s.clip ? &s.cliprect : nullptr) != 0)
+			throw Exception{"SDL_RenderSetClipRect"};
+	}
+
+	///Set the renderer draw color, if it changed
+	void set_color(Color const& c)
+	{
+		if (c == applied_color_) return;
+		if (SDL_SetRenderDrawColor(renderer_, c.r, c.g, c.b, c.a) != 0)
+			throw Exception{"SDL_SetRenderDrawColor"};
+		applied_color_ = c;
+	}
+
+	///Set the renderer draw blend mode, if it changed
+	void set_blend(SDL_BlendMode mode)
+	{
+		if (mode == applied_blend_) return;
+		if (SDL_SetRenderDrawBlendMode(renderer_, mode) != 0)
+			throw Exception{"SDL_SetRenderDrawBlendMode"};
+		applied_blend_ = mode;
+	}
+
+	///Set the renderer clip rect, if it changed
+	void set_clip(int clip)
+	{
+		if (clip == applied_clip_) return;
+		if (SDL_RenderSetClipRect(renderer_, clip < 0 ? nullptr : &clips_[size_t(clip)]) != 0)
+			throw Exception{"SDL_RenderSetClipRect"};
+		applied_clip_ = clip;
+	}
+
+	///Draw every group, in order
+	void draw_groups()
+	{
+		for (auto const& g : groups_)
+		{
+			set_clip(g.clip);
+			auto begin = sorted_.data() + g.first;
+			auto end   = begin + g.count;
+			switch (g.kind)
+			{
+			case Kind::quads: draw_quads(g, begin, end); break;
+			case Kind::points: draw_points(g, begin, end); break;
+			case Kind::lines: draw_lines(g, begin, end); break;
+			}
+		}
+	}
+
+	///Draw the rects and texture copies of a group
+	void draw_quads(Group const& g, Item const* begin, Item const* end)
+	{
+		if (!g.texture) set_blend(g.blend);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+		const auto quads = size_t(end - begin);
+		const auto sx	 = g.texture ? 1.f / float(g.texture_size.x) : 0.f;
+		const auto sy	 = g.texture ? 1.f / float(g.texture_size.y) : 0.f;
+
+		vertices_.clear();
+		for (auto it = begin; it != end; ++it)
+		{
+			const auto& d  = it->dst;
+			const auto& s  = it->src;
+			const auto	x1 = float(d.x), y1 = float(d.y);
+			const auto	x2 = float(d.x + d.w), y2 = float(d.y + d.h);
+			const auto	u1 = float(s.x) * sx, v1 = float(s.y) * sy;
+			const auto	u2 = float(s.x + s.w) * sx, v2 = float(s.y + s.h) * sy;
+
+			vertices_.push_back({{x1, y1}, it->color, {u1, v1}});
+			vertices_.push_back({{x2, y1}, it->color, {u2, v1}});
+			vertices_.push_back({{x1, y2}, it->color, {u1, v2}});
+			vertices_.push_back({{x2, y2}, it->color, {u2, v2}});
+		}
+
+		// Two triangles per quad. The pattern is shared by every group
+		for (auto q = indices_.size() / 6; q < quads; ++q)
+		{
+			const auto v = int(q * 4);
+			indices_.insert(indices_.end(), {v, v + 1, v + 2, v + 2, v + 1, v + 3});
+		}
+
+		if (SDL_RenderGeometry(
+				renderer_,
+				g.texture,
+				vertices_.data(),
+				int(vertices_.size()),
+				indices_.data(),
+				int(quads * 6))
+			!= 0)
+			throw Exception{"SDL_RenderGeometry"};
+#else
+		if (g.texture)
+		{
+			for (auto it = begin; it != end; ++it)
+				if (SDL_RenderCopy(renderer_, g.texture, &it->src, &it->dst) != 0)
+					throw Exception{"SDL_RenderCopy"};
+			return;
+		}
+
+		// One call per run of rects of the same color
+		for (auto it = begin; it != end;)
+		{
+			rects_.clear();
+			const auto color = it->color;
+			for (; it != end && it->color == color; ++it) rects_.push_back(it->dst);
+
+			set_color(color);
+			if (SDL_RenderFillRects(renderer_, rects_.data(), int(rects_.size())) != 0)
+				throw Exception{"SDL_RenderFillRects"};
+		}
+#endif
+	}
+
+	///Draw the points of a group
+	void draw_points(Group const& g, Item const* begin, Item const* end)
+	{
+		points_.clear();
+		for (auto it = begin; it != end; ++it) points_.push_back({it->dst.x, it->dst.y});
+
+		set_blend(g.blend);
+		set_color(g.color);
+		if (SDL_RenderDrawPoints(renderer_, points_.data(), int(points_.size())) != 0)
+			throw Exception{"SDL_RenderDrawPoints"};
+	}
+
+	///Draw the lines of a group
+	void draw_lines(Group const& g, Item const* begin, Item const* end)
+	{
+		set_blend(g.blend);
+		set_color(g.color);
+
+		for (auto it = begin; it != end;)
+		{
+			points_.clear();
+			points_.push_back({it->dst.x, it->dst.y});
+			do
+			{
+				points_.push_back({it->dst.w, it->dst.h});
+				++it;
+			} while (it != end && it->src.x == 1);
+
+			if (SDL_RenderDrawLines(renderer_, points_.data(), int(points_.size())) != 0)
+				throw Exception{"SDL_RenderDrawLines"};
+		}
+	}
+
+	///Renderer draws are flushed to
+	SDL_Renderer* renderer_;
+
+	///Draw state of the draws recorded next
+	Color		  color_ = {255, 255, 255, 255};
+	SDL_BlendMode blend_ = SDL_BLENDMODE_NONE;
+	int			  clip_	 = -1;
+
+	///Clip rects used by the groups
+	std::vector<Rect> clips_;
+	///Groups, in drawing order
+	std::vector<Group> groups_;
+	///Draws, in recording order
+	std::vector<Item> items_;
+
+	///Renderer state during flush()
+	Color		  applied_color_;
+	SDL_BlendMode applied_blend_ = SDL_BLENDMODE_NONE;
+	int			  applied_clip_	 = -2;
+
+	///Buffers reused by flush()
+	std::vector<Item>		sorted_;
+	std::vector<SDL_Point>	points_;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+	std::vector<SDL_Vertex> vertices_;
+	std::vector<int>		indices_;
+#else
+	std::vector<SDL_Rect> rects_;
+#endif
+};
+
+} // namespace sdl
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "color.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "renderer.hpp"
+#include "texture.hpp"
+#include "vec2.hpp"
+
+#include <SDL_events.h>
+#include <SDL_render.h>
+
+#include <functional>
+#include <utility>
+
+namespace sdl
+{
+namespace details
+{
+///\brief Set the blend mode of a target texture whose content is drawn with SDL_BLENDMODE_BLEND
+///onto transparent pixels. Return true if the mode is premultiplied.
+///
+///Such content holds colors already multiplied by their alpha: compositing it with
+///SDL_BLENDMODE_BLEND would multiply them again, and darken its translucent pixels. The texture
+///gets a premultiplied blend mode where the renderer supports one, and SDL_BLENDMODE_BLEND,
+///only right for opaque content, otherwise.
+inline bool set_premultiplied_blendmode(Texture const& texture)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 6)
+	const auto premultiplied = SDL_ComposeCustomBlendMode(
+		SDL_BLENDFACTOR_ONE,
+		SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+		SDL_BLENDOPERATION_ADD,
+		SDL_BLENDFACTOR_ONE,
+		SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+		SDL_BLENDOPERATION_ADD);
+	if (texture.try_set_blendmode(premultiplied)) return true;
+#endif
+	texture.set_blendmode(SDL_BLENDMODE_BLEND);
+	return false;
+}
+} // namespace details
+
+///Draw to a texture for the lifetime of this object, then go back to the previous target
+class ScopedRenderTarget
+{
+public:
+	///Keep the current target, to go back to it after drawing to several textures in a row with
+	///Renderer::set_target()
+	explicit ScopedRenderTarget(Renderer const& renderer)
+		: renderer_{renderer}, previous_{renderer.target()}
+	{
+	}
+
+	///Draw to texture. It must have been created with SDL_TEXTUREACCESS_TARGET
+	ScopedRenderTarget(Renderer const& renderer, Texture const& texture)
+		: renderer_{renderer}, previous_{renderer.target()}
+	{
+		renderer_.set_target(texture);
+	}
+
+	///Go back to the previous target
+	~ScopedRenderTarget()
+	{
+#ifndef CPP_SDL2_DISABLE_EXCEPTIONS
+		// Errors can't be thrown from here. Let the renderer query its state again instead
+		try
+		{
+			renderer_.set_target(previous_);
+		}
+		catch (Exception const&)
+		{
+			renderer_.invalidate_state();
+		}
+#else
+		renderer_.set_target(previous_);
+#endif
+	}
+
+	///This is a scope guard. this object is not copyable
+	ScopedRenderTarget(ScopedRenderTarget const&) = delete;
+	///This is a scope guard. this object is not copyable
+	ScopedRenderTarget& operator=(ScopedRenderTarget const&) = delete;
+
+private:
+	///Renderer the target is changed on
+	Renderer const& renderer_;
+	///Target to go back to
+	SDL_Texture* previous_;
+};
+
+///\brief Content drawn once to a texture, and then composited with a single copy per frame.
+///
+///The content is drawn by a function given to the layer. It is drawn again on the next render()
+///after invalidate() is called, or after the renderer lost the content of its target textures.
+///
+///Content drawn with SDL_BLENDMODE_BLEND looks the same as if drawn directly: the layer is
+///composited with a premultiplied blend mode. Where the renderer doesn't support it (SDL older
+///than 2.0.6, or the software renderer), translucent pixels of the layer come out darker, and
+///layers should be opaque.
+class Layer
+{
+public:
+	///Function drawing the layer content. The layer texture is the render target while it runs
+	using DrawFunction = std::function<void(Renderer const&)>;
+
+	///Create a layer
+	///\param size size of the layer texture
+	///\param draw function drawing the layer content
+	///\param background color the texture is cleared to before drawing the content
+	Layer(
+		Renderer const& renderer,
+		Vec2i			size,
+		DrawFunction	draw,
+		Color const&	background = Color::Transparent(),
+		Uint32			format	   = SDL_PIXELFORMAT_ARGB8888)
+		: renderer_{&renderer}
+		, texture_{renderer.ptr(), format, SDL_TEXTUREACCESS_TARGET, size}
+		, draw_{std::move(draw)}
+		, background_{background}
+	{
+		premultiplied_ = details::set_premultiplied_blendmode(texture_);
+	}
+
+	///Get the layer texture, drawing the content first if it is out of date
+	Texture const& texture()
+	{
+		update();
+		return texture_;
+	}
+
+	///Get the layer size
+	Vec2i size() const { return texture_.size(); }
+
+	///Replace the function drawing the content. The content is drawn again on next use
+	void set_draw(DrawFunction draw)
+	{
+		draw_ = std::move(draw);
+		invalidate();
+	}
+
+	///Mark the content as out of date, so that it is drawn again on next use
+	void invalidate() { valid_ = false; }
+	///Return true if the texture holds the current content
+	bool valid() const { return valid_; }
+
+	///Invalidate the layer if an event says the renderer lost its target textures. Return true if
+	///it did
+	bool handle(SDL_Event const& event)
+	{
+		if (event.type != SDL_RENDER_TARGETS_RESET && event.type != SDL_RENDER_DEVICE_RESET)
+			return false;
+
+		// After a device reset, textures have to be created again
+		if (event.type == SDL_RENDER_DEVICE_RESET)
+		{
+			texture_ = Texture{
+				renderer_->ptr(), texture_.format(), SDL_TEXTUREACCESS_TARGET, texture_.size()};
+			premultiplied_ = details::set_premultiplied_blendmode(texture_);
+		}
+
+		invalidate();
+		return true;
+	}
+
+	///Draw the content to the texture if it is out of date
+	void update()
+	{
+		if (valid_) return;
+
+		ScopedRenderTarget target{*renderer_, texture_};
+		// A premultiplied texture must hold its background premultiplied as well
+		auto background = background_;
+		if (premultiplied_)
+		{
+			background.r = Uint8(background.r * background.a / 255);
+			background.g = Uint8(background.g * background.a / 255);
+			background.b = Uint8(background.b * background.a / 255);
+		}
+		renderer_->clear(background);
+		if (draw_) draw_(*renderer_);
+		valid_ = true;
+	}
+
+	///Copy the layer to the current render target, drawing the content first if it is out of date
+	void render(Rect const& dest_rect)
+	{
+		update();
+		renderer_->render_copy(texture_, dest_rect);
+	}
+
+	///Copy the layer to the top left of the current render target
+	void render() { render(Rect{{0, 0}, size()}); }
+
+private:
+	///Renderer the layer is drawn with
+	Renderer const* renderer_;
+	///Texture holding the content
+	Texture texture_;
+	///Function drawing the content
+	DrawFunction draw_;
+	///Color the texture is cleared to
+	Color background_;
+	///False when the content has to be drawn again
+	bool valid_ = false;
+	///True if the texture is composited with a premultiplied blend mode
+	bool premultiplied_ = false;
+};
+
+} // namespace sdl
@@ -8,16 +8,25 @@
 
 #include <SDL.h>
 #include <SDL_render.h>
+#include <SDL_version.h>
 
+#include <cstddef>
 #include <utility>
 #include <vector>
 
 namespace sdl
 {
-///Class that represent a SDL2 2D renderer
+///\brief Class that represent a SDL2 2D renderer
+///
+///The draw color, blend mode, clip rect and render target set through this class are remembered,
+///and setting one of them to the value it already has doesn't call SDL. If the SDL_Renderer is
+///changed directly, call invalidate_state() afterwards.
 class Renderer
 {
 public:
+	///Number of render state changes sent to SDL, and of changes skipped as redundant
+	using StateStats = sdl::StateStats;
+
 	///Construct a renderer from the SDL_Renderer C object
 	explicit Renderer(SDL_Renderer* renderer) : renderer_{renderer} {}
 
@@ -34,7 +43,11 @@ public:
 		{
 			SDL_DestroyRenderer(renderer_);
 			renderer_		= other.renderer_;
+			state_			= other.state_;
+			stats_			= other.stats_;
 			other.renderer_ = nullptr;
+			other.state_	= {};
+			other.stats_	= {};
 		}
 		return *this;
 	}
@@ -65,49 +78,160 @@ public:
 		return info;
 	}
 
+	///Get the number of state changes sent to SDL and skipped since creation or reset_state_stats()
+	StateStats const& state_stats() const { return stats_; }
+
+	///Reset the state change counters
+	void reset_state_stats() const { stats_ = {}; }
+
+	///Forget the remembered render state, so that the next changes are all sent to SDL. Call it
+	///after changing the state of ptr() without this class
+	void invalidate_state() const { state_ = {}; }
+
 	// Get the current draw color
 	Color drawcolor() const
 	{
-		Color c;
-		if (SDL_GetRenderDrawColor(renderer_, &c.r, &c.g, &c.b, &c.a) != 0)
-			throw Exception{"SDL_GetRenderDrawColor"};
-		return c;
+		if (!state_.color_known)
+		{
+			Color c;
+			if (SDL_GetRenderDrawColor(renderer_, &c.r, &c.g, &c.b, &c.a) != 0)
+				throw Exception{"SDL_GetRenderDrawColor"};
+			state_.color	   = c;
+			state_.color_known = true;
+		}
+		return state_.color;
 	}
 
 	///Set the drawcolor from color values as bytes
 	void set_drawcolor(Uint8 r, Uint8 g, Uint8 b, Uint8 a = SDL_ALPHA_OPAQUE) const
 	{
+		const auto c = Color{r, g, b, a};
+		if (state_.color_known && state_.color == c)
+		{
+			++stats_.skipped;
+			return;
+		}
+
 		if (SDL_SetRenderDrawColor(renderer_, r, g, b, a) != 0)
 			throw Exception{"SDL_SetRenderDrawColor"};
+		state_.color	   = c;
+		state_.color_known = true;
+		++stats_.issued;
 	}
 
 	///Set the drawcolor from color struct
 	void set_drawcolor(Color const& c) const { set_drawcolor(c.r, c.g, c.b, c.a); }
 
+	///Get the blend mode used by draw operations
+	SDL_BlendMode blendmode() const
+	{
+		if (!state_.blend_known)
+		{
+			if (SDL_GetRenderDrawBlendMode(renderer_, &state_.blend) != 0)
+				throw Exception{"SDL_GetRenderDrawBlendMode"};
+			state_.blend_known = true;
+		}
+		return state_.blend;
+	}
+
+	///Set the blend mode used by draw operations
+	void set_blendmode(SDL_BlendMode mode) const
+	{
+		if (state_.blend_known && state_.blend == mode)
+		{
+			++stats_.skipped;
+			return;
+		}
+
+		if (SDL_SetRenderDrawBlendMode(renderer_, mode) != 0)
+			throw Exception{"SDL_SetRenderDrawBlendMode"};
+		state_.blend	   = mode;
+		state_.blend_known = true;
+		++stats_.issued;
+	}
+
 	///Get the clipping rectangle
 	Rect cliprect() const
 	{
-		Rect r;
-		SDL_RenderGetClipRect(renderer_, &r);
-		return r;
+		query_clip();
+		return state_.clip;
 	}
 
 	///Set the clipping rectangle
 	void set_cliprect(Rect const& r) const
 	{
+		if (state_.clip_known && state_.clip_enabled && state_.clip == r)
+		{
+			++stats_.skipped;
+			return;
+		}
+
 		if (SDL_RenderSetClipRect(renderer_, &r) != 0) throw Exception{"SDL_RenderSetClipRect"};
+		state_.clip			= r;
+		state_.clip_enabled = true;
+		state_.clip_known	= true;
+		++stats_.issued;
 	}
 
 	///Return true if clipping is enable
-	bool clip_enabled() const { return SDL_RenderIsClipEnabled(renderer_); }
+	bool clip_enabled() const
+	{
+		query_clip();
+		return state_.clip_enabled;
+	}
 
 	///Disable the clipping rectangle
 	void disable_clip() const
 	{
+		if (state_.clip_known && !state_.clip_enabled)
+		{
+			++stats_.skipped;
+			return;
+		}
+
 		if (SDL_RenderSetClipRect(renderer_, nullptr) != 0)
 			throw Exception{"SDL_RenderSetClipRect"};
+		state_.clip			= Rect{};
+		state_.clip_enabled = false;
+		state_.clip_known	= true;
+		++stats_.issued;
 	}
 
+	///Get the texture drawn to, or nullptr when drawing to the window
+	SDL_Texture* target() const
+	{
+		if (!state_.target_known)
+		{
+			state_.target		= SDL_GetRenderTarget(renderer_);
+			state_.target_known = true;
+		}
+		return state_.target;
+	}
+
+	///Draw to a texture. It must have been created with SDL_TEXTUREACCESS_TARGET
+	void set_target(Texture const& texture) const { set_target(texture.ptr()); }
+
+	///Draw to a texture, or to the window if texture is nullptr
+	void set_target(SDL_Texture* texture) const
+	{
+		if (state_.target_known && state_.target == texture)
+		{
+			++stats_.skipped;
+			return;
+		}
+
+		if (SDL_SetRenderTarget(renderer_, texture) != 0) throw Exception{"SDL_SetRenderTarget"};
+		state_.target		= texture;
+		state_.target_known = true;
+		++stats_.issued;
+
+		// Each target has its own clip rect
+		state_.clip_known = false;
+	}
+
+	///Draw to the window again
+	void reset_target() const { set_target(nullptr); }
+
 	///Get the current integer scale
 	bool intscale() const { return SDL_RenderGetIntegerScale(renderer_); }
 
@@ -137,17 +261,124 @@ public:
 	///\param filename file path
 	Texture make_texture(std::string const& filename) const { return Texture{renderer_, filename}; }
 
+	///Copy part of a texture to part of the render target
 	void render_copy(Texture const& tex, Rect const& source_rect, Rect const& dest_rect) const
 	{
-		// SDL will *not* modify the texture or the rects here, but the
-		// signature has a non-const pointer So we are forced to cast away our
-		// const ref on texture
-		SDL_RenderCopy(renderer_, const_cast<Texture&>(tex).ptr(), &source_rect, &dest_rect);
+		if (SDL_RenderCopy(renderer_, tex.ptr(), &source_rect, &dest_rect) != 0)
+			throw Exception{"SDL_RenderCopy"};
+	}
+
+	///Copy a whole texture to part of the render target
+	void render_copy(Texture const& tex, Rect const& dest_rect) const
+	{
+		if (SDL_RenderCopy(renderer_, tex.ptr(), nullptr, &dest_rect) != 0)
+			throw Exception{"SDL_RenderCopy"};
+	}
+
+	///Copy part of a texture to part of the render target, rotated and flipped
+	///\param angle clockwise rotation, in degrees
+	///\param center point the copy rotates around, relative to dest_rect
+	void render_copy_ex(
+		Texture const&	 tex,
+		Rect const&		 source_rect,
+		Rect const&		 dest_rect,
+		double			 angle,
+		Vec2i const&	 center,
+		SDL_RendererFlip flip = SDL_FLIP_NONE) const
+	{
+		if (SDL_RenderCopyEx(renderer_, tex.ptr(), &source_rect, &dest_rect, angle, &center, flip)
+			!= 0)
+			throw Exception{"SDL_RenderCopyEx"};
 	}
 
+	///Copy part of a texture to part of the render target, rotated around the center of dest_rect
+	///and flipped
+	///\param angle clockwise rotation, in degrees
+	void render_copy_ex(
+		Texture const&	 tex,
+		Rect const&		 source_rect,
+		Rect const&		 dest_rect,
+		double			 angle,
+		SDL_RendererFlip flip = SDL_FLIP_NONE) const
+	{
+		if (SDL_RenderCopyEx(renderer_, tex.ptr(), &source_rect, &dest_rect, angle, nullptr, flip)
+			!= 0)
+			throw Exception{"SDL_RenderCopyEx"};
+	}
+
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+	///Copy part of a texture to part of the render target, with subpixel precision
+	void render_copy(Texture const& tex, Rect const& source_rect, FRect const& dest_rect) const
+	{
+		if (SDL_RenderCopyF(renderer_, tex.ptr(), &source_rect, &dest_rect) != 0)
+			throw Exception{"SDL_RenderCopyF"};
+	}
+
+	///Copy part of a texture to part of the render target, rotated and flipped, with subpixel
+	///precision
+	///\param angle clockwise rotation, in degrees
+	///\param center point the copy rotates around, relative to dest_rect
+	void render_copy_ex(
+		Texture const&	 tex,
+		Rect const&		 source_rect,
+		FRect const&	 dest_rect,
+		double			 angle,
+		Vec2f const&	 center,
+		SDL_RendererFlip flip = SDL_FLIP_NONE) const
+	{
+		if (SDL_RenderCopyExF(renderer_, tex.ptr(), &source_rect, &dest_rect, angle, &center, flip)
+			!= 0)
+			throw Exception{"SDL_RenderCopyExF"};
+	}
+#endif
+
 	///Present renderer
 	void present() const { SDL_RenderPresent(renderer_); }
 
+	///Get the size of the rendering output, in pixels
+	Vec2i output_size() const
+	{
+		Vec2i size;
+		if (SDL_GetRendererOutputSize(renderer_, &size.x, &size.y) != 0)
+			throw Exception{"SDL_GetRendererOutputSize"};
+		return size;
+	}
+
+	///\brief Copy pixels of the current render target to memory.
+	///
+	///This waits for the GPU to finish drawing, and is slow: avoid it on every frame.
+	void read_pixels(Rect const& area, Uint32 format, void* pixels, int pitch) const
+	{
+		if (SDL_RenderReadPixels(renderer_, &area, format, pixels, pitch) != 0)
+			throw Exception{"SDL_RenderReadPixels"};
+	}
+
+	///Copy pixels of the current render target to the top left of a surface, in its format
+	void read_pixels(Rect const& area, Surface& dst) const
+	{
+		auto s = dst.ptr();
+		if (area.w > s->w || area.h > s->h)
+		{
+			SDL_SetError(
+				"Cannot read %dx%d pixels into a %dx%d surface", area.w, area.h, s->w, s->h);
+			throw Exception{"Renderer::read_pixels"};
+		}
+
+		if (SDL_MUSTLOCK(s) && SDL_LockSurface(s) != 0) throw Exception{"SDL_LockSurface"};
+		const auto result
+			= SDL_RenderReadPixels(renderer_, &area, dst.format(), s->pixels, s->pitch);
+		if (SDL_MUSTLOCK(s)) SDL_UnlockSurface(s);
+		if (result != 0) throw Exception{"SDL_RenderReadPixels"};
+	}
+
+	///Copy pixels of the current render target to a new surface
+	Surface read_pixels(Rect const& area, Uint32 format = SDL_PIXELFORMAT_ARGB8888) const
+	{
+		auto s = Surface{0, area.w, area.h, int(SDL_BITSPERPIXEL(format)), format};
+		read_pixels(area, s);
+		return s;
+	}
+
 	///Clear renderer
 	void clear() const
 	{
@@ -175,18 +406,31 @@ public:
 		draw_line(pos1, pos2);
 	}
 
+	///Draw lines joining count points
+	void draw_lines(Vec2i const* points, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderDrawLines(renderer_, points, int(count)) != 0)
+			throw Exception{"SDL_RenderDrawLines"};
+	}
+
+	///Draw lines joining count points with specified color
+	void draw_lines(Vec2i const* points, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_lines(points, count);
+	}
+
 	///Draw array of lines
 	void draw_lines(std::vector<Vec2i> const& points) const
 	{
-		if (SDL_RenderDrawLines(renderer_, &points[0], (int)points.size()) != 0)
-			throw Exception{"SDL_RenderDrawLines"};
+		draw_lines(points.data(), points.size());
 	}
 
 	///Draw array of lines with specified color
 	void draw_lines(std::vector<Vec2i> const& points, Color const& c) const
 	{
-		set_drawcolor(c);
-		draw_lines(points);
+		draw_lines(points.data(), points.size(), c);
 	}
 
 	///Draw point
@@ -203,18 +447,31 @@ public:
 		draw_point(point);
 	}
 
+	///Draw count points
+	void draw_points(Vec2i const* points, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderDrawPoints(renderer_, points, int(count)) != 0)
+			throw Exception{"SDL_RenderDrawPoints"};
+	}
+
+	///Draw count points with specified color
+	void draw_points(Vec2i const* points, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_points(points, count);
+	}
+
 	///Draw array of points
 	void draw_points(std::vector<Vec2i> const& points) const
 	{
-		if (SDL_RenderDrawPoints(renderer_, &points[0], (int)points.size()) != 0)
-			throw Exception{"SDL_RenderDrawPoints"};
+		draw_points(points.data(), points.size());
 	}
 
 	///Draw array of points with specified color
 	void draw_points(std::vector<Vec2i> const& points, Color const& c) const
 	{
-		set_drawcolor(c);
-		draw_points(points);
+		draw_points(points.data(), points.size(), c);
 	}
 
 	void draw_ray(Vec2i const& orig, Vec2i const& ray) const { draw_line(orig, orig + ray); }
@@ -236,17 +493,30 @@ public:
 		draw_rect(rect);
 	}
 
+	///Draw count rectangles
+	void draw_rects(Rect const* rects, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderDrawRects(renderer_, rects, int(count)) != 0)
+			throw Exception{"SDL_RenderDrawRects"};
+	}
+
+	///Draw count rectangles with specified color
+	void draw_rects(Rect const* rects, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_rects(rects, count);
+	}
+
 	///Draw array of rectangles
 	void draw_rects(std::vector<Rect> const& rects) const
 	{
-		if (SDL_RenderDrawRects(renderer_, &rects[0], (int)rects.size()) != 0)
-			throw Exception{"SDL_RenderDrawRects"};
+		draw_rects(rects.data(), rects.size());
 	}
 	///Draw array of rectangles with specified colors
 	void draw_rects(std::vector<Rect> const& rects, const Color& c) const
 	{
-		set_drawcolor(c);
-		draw_rects(rects);
+		draw_rects(rects.data(), rects.size(), c);
 	}
 
 	///Fill rectangle
@@ -261,22 +531,226 @@ public:
 		fill_rect(rect);
 	}
 
+	///Fill count rectangles
+	void fill_rects(Rect const* rects, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderFillRects(renderer_, rects, int(count)) != 0)
+			throw Exception{"SDL_RenderFillRects"};
+	}
+
+	///Fill count rectangles with specified color
+	void fill_rects(Rect const* rects, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		fill_rects(rects, count);
+	}
+
 	///Fill array of rectangles
 	void fill_rects(std::vector<Rect> const& rects) const
 	{
-		if (SDL_RenderFillRects(renderer_, &rects[0], (int)rects.size()) != 0)
-			throw Exception{"SDL_RenderDrawRects"};
+		fill_rects(rects.data(), rects.size());
 	}
 	///Fill array of rectangles with specified colors
-	void fill_rects(std::vector<Rect> const& rects, Color const& c)
+	void fill_rects(std::vector<Rect> const& rects, Color const& c) const
+	{
+		fill_rects(rects.data(), rects.size(), c);
+	}
+
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+	///Draw line between two points, with subpixel precision
+	void draw_line(Vec2f const& pos1, Vec2f const& pos2) const
+	{
+		if (SDL_RenderDrawLineF(renderer_, pos1.x, pos1.y, pos2.x, pos2.y) != 0)
+			throw Exception{"SDL_RenderDrawLineF"};
+	}
+
+	///Draw line between two points with specified color, with subpixel precision
+	void draw_line(Vec2f const& pos1, Vec2f const& pos2, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_line(pos1, pos2);
+	}
+
+	///Draw lines joining count points, with subpixel precision
+	void draw_lines(Vec2f const* points, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderDrawLinesF(renderer_, points, int(count)) != 0)
+			throw Exception{"SDL_RenderDrawLinesF"};
+	}
+
+	///Draw lines joining count points with specified color, with subpixel precision
+	void draw_lines(Vec2f const* points, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_lines(points, count);
+	}
+
+	///Draw array of lines, with subpixel precision
+	void draw_lines(std::vector<Vec2f> const& points) const
+	{
+		draw_lines(points.data(), points.size());
+	}
+
+	///Draw array of lines with specified color, with subpixel precision
+	void draw_lines(std::vector<Vec2f> const& points, Color const& c) const
+	{
+		draw_lines(points.data(), points.size(), c);
+	}
+
+	///Draw point, with subpixel precision
+	void draw_point(Vec2f const& point) const
+	{
+		if (SDL_RenderDrawPointF(renderer_, point.x, point.y) != 0)
+			throw Exception{"SDL_RenderDrawPointF"};
+	}
+
+	///Draw point with specified color, with subpixel precision
+	void draw_point(Vec2f const& point, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_point(point);
+	}
+
+	///Draw count points, with subpixel precision
+	void draw_points(Vec2f const* points, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderDrawPointsF(renderer_, points, int(count)) != 0)
+			throw Exception{"SDL_RenderDrawPointsF"};
+	}
+
+	///Draw count points with specified color, with subpixel precision
+	void draw_points(Vec2f const* points, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_points(points, count);
+	}
+
+	///Draw array of points, with subpixel precision
+	void draw_points(std::vector<Vec2f> const& points) const
+	{
+		draw_points(points.data(), points.size());
+	}
+
+	///Draw array of points with specified color, with subpixel precision
+	void draw_points(std::vector<Vec2f> const& points, Color const& c) const
+	{
+		draw_points(points.data(), points.size(), c);
+	}
+
+	///Draw rectangle, with subpixel precision
+	void draw_rect(FRect const& rect) const
+	{
+		if (SDL_RenderDrawRectF(renderer_, &rect) != 0) throw Exception{"SDL_RenderDrawRectF"};
+	}
+
+	///Draw rectangle with specified color, with subpixel precision
+	void draw_rect(FRect const& rect, Color const& c) const
 	{
 		set_drawcolor(c);
-		fill_rects(rects);
+		draw_rect(rect);
 	}
 
+	///Draw count rectangles, with subpixel precision
+	void draw_rects(FRect const* rects, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderDrawRectsF(renderer_, rects, int(count)) != 0)
+			throw Exception{"SDL_RenderDrawRectsF"};
+	}
+
+	///Draw count rectangles with specified color, with subpixel precision
+	void draw_rects(FRect const* rects, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		draw_rects(rects, count);
+	}
+
+	///Draw array of rectangles, with subpixel precision
+	void draw_rects(std::vector<FRect> const& rects) const
+	{
+		draw_rects(rects.data(), rects.size());
+	}
+
+	///Draw array of rectangles with specified color, with subpixel precision
+	void draw_rects(std::vector<FRect> const& rects, Color const& c) const
+	{
+		draw_rects(rects.data(), rects.size(), c);
+	}
+
+	///Fill rectangle, with subpixel precision
+	void fill_rect(FRect const& rect) const
+	{
+		if (SDL_RenderFillRectF(renderer_, &rect) != 0) throw Exception{"SDL_RenderFillRectF"};
+	}
+
+	///Fill rectangle with specified color, with subpixel precision
+	void fill_rect(FRect const& rect, Color const& c) const
+	{
+		set_drawcolor(c);
+		fill_rect(rect);
+	}
+
+	///Fill count rectangles, with subpixel precision
+	void fill_rects(FRect const* rects, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_RenderFillRectsF(renderer_, rects, int(count)) != 0)
+			throw Exception{"SDL_RenderFillRectsF"};
+	}
+
+	///Fill count rectangles with specified color, with subpixel precision
+	void fill_rects(FRect const* rects, size_t count, Color const& c) const
+	{
+		set_drawcolor(c);
+		fill_rects(rects, count);
+	}
+
+	///Fill array of rectangles, with subpixel precision
+	void fill_rects(std::vector<FRect> const& rects) const
+	{
+		fill_rects(rects.data(), rects.size());
+	}
+
+	///Fill array of rectangles with specified color, with subpixel precision
+	void fill_rects(std::vector<FRect> const& rects, Color const& c) const
+	{
+		fill_rects(rects.data(), rects.size(), c);
+	}
+#endif
+
 private:
+	///Render state last set through this object. Unknown values are queried when needed
+	struct State
+	{
+		bool		  color_known  = false;
+		Color		  color;
+		bool		  blend_known  = false;
+		SDL_BlendMode blend		   = SDL_BLENDMODE_NONE;
+		bool		  clip_known   = false;
+		bool		  clip_enabled = false;
+		Rect		  clip;
+		bool		  target_known = false;
+		SDL_Texture*  target	   = nullptr;
+	};
+
+	///Make sure the clip state is known
+	void query_clip() const
+	{
+		if (state_.clip_known) return;
+		SDL_RenderGetClipRect(renderer_, &state_.clip);
+		state_.clip_enabled = SDL_RenderIsClipEnabled(renderer_);
+		state_.clip_known	= true;
+	}
+
 	///Pointer to raw SDL_Renderer
 	SDL_Renderer* renderer_ = nullptr;
+	///Remembered render state
+	mutable State state_;
+	///Render state changes counters
+	mutable StateStats stats_;
 };
 
 } // namespace sdl
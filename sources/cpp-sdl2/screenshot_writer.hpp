@@ -0,0 +1,203 @@
+#pragma once
+
+#include "SDL_version.h"
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+
+#include "bounded_queue.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "renderer.hpp"
+#include "surface.hpp"
+#include "surface_pool.hpp"
+
+#include <SDL_render.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace sdl
+{
+///\brief Saves frames read back from a renderer to files on a background thread.
+///
+///capture() only copies the pixels out of the renderer, into a surface taken from a SurfacePool,
+///and queues it. Encoding and writing the file happen on a thread owned by this object, so the
+///render thread never waits for the disk. When the writer falls behind by more than max_pending
+///frames, new captures are dropped instead of piling up; see dropped().
+class ScreenshotWriter
+{
+public:
+	///Function writing a frame to a file. Throws on failure
+	using Encoder = std::function<void(Surface const&, std::string const&)>;
+
+	///Write a surface as a BMP file
+	static void save_bmp(Surface const& frame, std::string const& path) { frame.save_bmp(path); }
+
+	///Start the writer thread
+	///\param max_pending number of frames waiting to be written before captures are dropped
+	///\param format pixel format frames are read in
+	///\param encoder function writing each frame
+	explicit ScreenshotWriter(
+		size_t	max_pending = 4,
+		Uint32	format		= SDL_PIXELFORMAT_ARGB8888,
+		Encoder encoder		= save_bmp)
+		: queue_{max_pending}
+		, pool_{max_pending + 1}
+		, format_{format}
+		, encoder_{std::move(encoder)}
+		, thread_{[this] { work(); }}
+	{
+	}
+
+	///Write the frames still queued, and stop the writer thread
+	~ScreenshotWriter()
+	{
+		queue_.close();
+		thread_.join();
+	}
+
+	///This object owns a thread, it is not copyable
+	ScreenshotWriter(ScreenshotWriter const&) = delete;
+	///This object owns a thread, it is not copyable
+	ScreenshotWriter& operator=(ScreenshotWriter const&) = delete;
+
+	///\brief Read an area of the current render target, and queue it to be written to path.
+	///
+	///Call it after drawing and before Renderer::present(). Return false if the frame was dropped
+	///because too many frames are waiting to be written.
+	bool capture(Renderer const& renderer, Rect const& area, std::string path)
+	{
+		if (queue_.size() >= queue_.capacity())
+		{
+			++dropped_;
+			return false;
+		}
+
+		auto job = Job{pool_.acquire(area.w, area.h, format_), std::move(path)};
+		renderer.read_pixels(area, *job.frame);
+
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			++pending_;
+		}
+		if (!queue_.try_push(std::move(job)))
+		{
+			done();
+			++dropped_;
+			return false;
+		}
+		return true;
+	}
+
+	///Read the whole current render target, and queue it to be written to path
+	bool capture(Renderer const& renderer, std::string path)
+	{
+		const auto size = renderer.output_size();
+		return capture(renderer, Rect{0, 0, size.x, size.y}, std::move(path));
+	}
+
+	///Wait until every queued frame is written
+	void flush()
+	{
+		std::unique_lock<std::mutex> lock{mutex_};
+		idle_.wait(lock, [this] { return pending_ == 0; });
+	}
+
+	///Get the number of frames written
+	size_t written() const { return written_; }
+	///Get the number of frames dropped because the writer was behind
+	size_t dropped() const { return dropped_; }
+	///Get the number of frames the encoder failed to write
+	size_t failed() const { return failed_; }
+	///Get the number of frames waiting to be written
+	size_t pending() const
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		return pending_;
+	}
+
+private:
+	///A frame to write
+	struct Job
+	{
+		SurfacePool::PooledSurface frame;
+		std::string				   path;
+	};
+
+	///Writer thread: write frames until the queue is closed and empty
+	void work()
+	{
+		Job job;
+		while (queue_.pop(job))
+		{
+			write(job);
+			// Give the surface back to the pool before saying the frame is done
+			job = Job{};
+			done();
+		}
+	}
+
+	///Write one frame, counting failures instead of letting them escape the thread
+	void write(Job const& job)
+	{
+#ifndef CPP_SDL2_DISABLE_EXCEPTIONS
+		try
+		{
+			encoder_(*job.frame, job.path);
+			++written_;
+		}
+		catch (Exception const&)
+		{
+			++failed_;
+		}
+#else
+		encoder_(*job.frame, job.path);
+		++written_;
+#endif
+	}
+
+	///Mark a queued frame as handled
+	void done()
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			--pending_;
+		}
+		idle_.notify_all();
+	}
+
+	///Frames waiting for the writer thread
+	BoundedQueue<Job> queue_;
+	///Surfaces frames are read into, recycled once written
+	SurfacePool pool_;
+	///Pixel format frames are read in
+	Uint32 format_;
+	///Function writing a frame
+	Encoder encoder_;
+
+	///Protect pending_
+	mutable std::mutex mutex_;
+	///Signaled when a frame is handled
+	std::condition_variable idle_;
+	///Frames captured and not handled yet
+	size_t pending_ = 0;
+
+	///Frames written
+	std::atomic<size_t> written_{0};
+	///Frames dropped because the queue was full
+	std::atomic<size_t> dropped_{0};
+	///Frames the encoder failed to write
+	std::atomic<size_t> failed_{0};
+
+	///Writer thread, started last so that every other member is ready
+	std::thread thread_;
+};
+
+} // namespace sdl
+
+#endif // SDL_VERSION_ATLEAST(2, 0, 10)
@@ -2,23 +2,48 @@
 
 #include <SDL.h>
 
+#include "bounded_queue.hpp"
 #include "color.hpp"
+#include "compositor.hpp"
+#include "dirty_region.hpp"
 #include "event.hpp"
+#include "event_buffer.hpp"
+#include "event_coalescer.hpp"
+#include "event_dispatcher.hpp"
+#include "event_queue.hpp"
+#include "event_recorder.hpp"
 #include "exception.hpp"
 #include "game_controller.hpp"
 #include "haptic.hpp"
+#include "input_state.hpp"
 #include "joystick.hpp"
 #include "mouse.hpp"
+#include "pixel_algorithm.hpp"
+#include "pixel_convert.hpp"
+#include "pixel_format.hpp"
 #include "rect.hpp"
+#include "render_batch.hpp"
+#include "render_target.hpp"
 #include "renderer.hpp"
+#include "screenshot_writer.hpp"
 #include "shared_object.hpp"
 #include "simd.hpp"
+#include "sprite_batch.hpp"
+#include "streaming_texture.hpp"
 #include "surface.hpp"
+#include "surface_pool.hpp"
+#include "system.hpp"
 #include "texture.hpp"
+#include "texture_atlas.hpp"
+#include "thread_pool.hpp"
+#include "tilemap.hpp"
 #include "timer.hpp"
 #include "utils.hpp"
 #include "vec2.hpp"
+#include "video_recorder.hpp"
 #include "window.hpp"
+#include "window_surface.hpp"
+#include "yuv_convert.hpp"
 
 /**
  *
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "SDL_version.h"
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+
+#include "color.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "renderer.hpp"
+#include "texture.hpp"
+#include "texture_atlas.hpp"
+#include "vec2.hpp"
+
+#include <SDL_render.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace sdl
+{
+///\brief Queue of textured quads drawn with one SDL_RenderGeometry() call per texture change.
+///
+///Each sprite is turned into four vertices as soon as it is added, with its tint in the vertex
+///colors and its rotation and flip applied to the positions and texture coordinates. flush() then
+///draws the sprites in the order they were added, with one SDL_RenderGeometry() call for each run
+///of sprites sharing a texture. Packing images in a TextureAtlas keeps those runs long.
+class SpriteBatch
+{
+public:
+	///Create a batch drawing on a renderer
+	explicit SpriteBatch(SDL_Renderer* renderer) : renderer_{renderer} {}
+
+	///Create a batch drawing on a renderer
+	explicit SpriteBatch(Renderer const& renderer) : SpriteBatch{renderer.ptr()} {}
+
+	///Make room for a number of sprites
+	void reserve(size_t sprites)
+	{
+		vertices_.reserve(sprites * 4);
+		grow_indices(sprites);
+	}
+
+	///Add a sprite
+	///\param source_rect part of the texture to draw
+	///\param dest_rect where to draw it, before rotation
+	///\param tint color the texture is multiplied by
+	///\param angle clockwise rotation around the center of dest_rect, in degrees
+	void draw(
+		Texture const&	 tex,
+		Rect const&		 source_rect,
+		FRect const&	 dest_rect,
+		Color const&	 tint  = Color::White(),
+		double			 angle = 0,
+		SDL_RendererFlip flip  = SDL_FLIP_NONE)
+	{
+		draw(tex, source_rect, dest_rect, dest_rect.size() / 2.f, tint, angle, flip);
+	}
+
+	///Add a sprite
+	///\param source_rect part of the texture to draw
+	///\param dest_rect where to draw it, before rotation
+	///\param center point the sprite rotates around, relative to dest_rect
+	///\param tint color the texture is multiplied by
+	///\param angle clockwise rotation, in degrees
+	void draw(
+		Texture const&	 tex,
+		Rect const&		 source_rect,
+		FRect const&	 dest_rect,
+		Vec2f const&	 center,
+		Color const&	 tint,
+		double			 angle,
+		SDL_RendererFlip flip = SDL_FLIP_NONE)
+	{
+		auto texture = tex.ptr();
+		if (runs_.empty() || runs_.back().texture != texture)
+		{
+			const auto size = tex.size();
+			runs_.push_back({texture, 1.f / float(size.x), 1.f / float(size.y), quads(), 0});
+		}
+		auto& run = runs_.back();
+		++run.count;
+
+		// Texture coordinates, swapped to flip
+		auto u1 = float(source_rect.x) * run.du, u2 = float(source_rect.x + source_rect.w) * run.du;
+		auto v1 = float(source_rect.y) * run.dv, v2 = float(source_rect.y + source_rect.h) * run.dv;
+		if (flip & SDL_FLIP_HORIZONTAL) std::swap(u1, u2);
+		if (flip & SDL_FLIP_VERTICAL) std::swap(v1, v2);
+
+		// Corners relative to the rotation center
+		const auto x1 = -center.x, x2 = dest_rect.w - center.x;
+		const auto y1 = -center.y, y2 = dest_rect.h - center.y;
+		const auto ox = dest_rect.x + center.x, oy = dest_rect.y + center.y;
+
+		if (angle == 0)
+		{
+			push(ox + x1, oy + y1, tint, u1, v1);
+			push(ox + x2, oy + y1, tint, u2, v1);
+			push(ox + x1, oy + y2, tint, u1, v2);
+			push(ox + x2, oy + y2, tint, u2, v2);
+			return;
+		}
+
+		const auto rad = angle * (3.14159265358979323846 / 180.);
+		const auto c = float(std::cos(rad)), s = float(std::sin(rad));
+		push(ox + x1 * c - y1 * s, oy + x1 * s + y1 * c, tint, u1, v1);
+		push(ox + x2 * c - y1 * s, oy + x2 * s + y1 * c, tint, u2, v1);
+		push(ox + x1 * c - y2 * s, oy + x1 * s + y2 * c, tint, u1, v2);
+		push(ox + x2 * c - y2 * s, oy + x2 * s + y2 * c, tint, u2, v2);
+	}
+
+	///Add a sprite showing an image of a texture atlas
+	///\param dest_rect where to draw it, before rotation
+	///\param tint color the texture is multiplied by
+	///\param angle clockwise rotation around the center of dest_rect, in degrees
+	void draw(
+		TextureAtlas::Region const& region,
+		FRect const&				dest_rect,
+		Color const&				tint  = Color::White(),
+		double						angle = 0,
+		SDL_RendererFlip			flip  = SDL_FLIP_NONE)
+	{
+		draw(*region.texture, region.rect, dest_rect, tint, angle, flip);
+	}
+
+	///Get the number of sprites queued
+	size_t size() const { return quads(); }
+	///Return true if no sprite is queued
+	bool empty() const { return vertices_.empty(); }
+	///Get the number of SDL_RenderGeometry() calls the next flush() makes
+	size_t draw_calls() const { return runs_.size(); }
+
+	///Forget every queued sprite
+	void clear()
+	{
+		vertices_.clear();
+		runs_.clear();
+	}
+
+	///Draw every queued sprite, and forget them
+	void flush()
+	{
+		size_t longest = 0;
+		for (auto const& run : runs_) longest = std::max(longest, run.count);
+		grow_indices(longest);
+
+		for (auto const& run : runs_)
+		{
+			if (SDL_RenderGeometry(
+					renderer_,
+					run.texture,
+					vertices_.data() + run.first * 4,
+					int(run.count * 4),
+					indices_.data(),
+					int(run.count * 6))
+				!= 0)
+			{
+				clear();
+				throw Exception{"SDL_RenderGeometry"};
+			}
+		}
+
+		clear();
+	}
+
+private:
+	///Consecutive sprites sharing a texture
+	struct Run
+	{
+		SDL_Texture* texture;
+		///Inverse of the texture size, to get texture coordinates
+		float du, dv;
+		///Index of the first sprite, and number of sprites
+		size_t first, count;
+	};
+
+	///Number of sprites queued
+	size_t quads() const { return vertices_.size() / 4; }
+
+	///Add a vertex
+	void push(float x, float y, Color const& color, float u, float v)
+	{
+		vertices_.push_back({{x, y}, color, {u, v}});
+	}
+
+	///Make sure there are indices for a number of sprites. Every run uses the same indices, since
+	///vertices are passed from the start of the run
+	void grow_indices(size_t sprites)
+	{
+		for (auto q = indices_.size() / 6; q < sprites; ++q)
+		{
+			const auto v = int(q * 4);
+			indices_.insert(indices_.end(), {v, v + 1, v + 2, v + 2, v + 1, v + 3});
+		}
+	}
+
+	///Renderer sprites are drawn on
+	SDL_Renderer* renderer_;
+	///Four vertices per sprite
+	std::vector<SDL_Vertex> vertices_;
+	///Two triangles per sprite
+	std::vector<int> indices_;
+	///Runs of sprites sharing a texture, in drawing order
+	std::vector<Run> runs_;
+};
+
+} // namespace sdl
+
+#endif // SDL_VERSION_ATLEAST(2, 0, 18)
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "color.hpp"
+#include "dirty_region.hpp"
+#include "exception.hpp"
+#include "pixel.hpp"
+#include "pixel_format.hpp"
+#include "pixel_view.hpp"
+#include "rect.hpp"
+#include "texture.hpp"
+#include "vec2.hpp"
+
+#include <SDL_render.h>
+
+#include <cstring>
+#include <vector>
+
+namespace sdl
+{
+///\brief Streaming texture with a CPU copy of its pixels, that only uploads what changed.
+///
+///Pixels are written to the CPU copy, and the written rects are recorded in a DirtyRegion.
+///upload() then sends each dirty rect to the texture with SDL_UpdateTexture(), and clears the
+///region. Format and size are queried once, when the texture is created.
+class StreamingTexture
+{
+public:
+	///Create a streaming texture, and its CPU copy. Pixels start zeroed
+	///\param max_rects number of dirty rects kept before merging them
+	StreamingTexture(SDL_Renderer* render, Uint32 format, Vec2i size, size_t max_rects = 16)
+		: texture_{render, checked_format(format), SDL_TEXTUREACCESS_STREAMING, size}
+		, format_{&PixelFormat::get(format)}
+		, size_{size}
+		, pitch_{(size.x * format_->BytesPerPixel + 3) & ~3}
+		, pixels_(size_t(pitch_) * size_t(size.y))
+		, dirty_{Rect{{0, 0}, size}, max_rects}
+	{
+		dirty_.add_all();
+	}
+
+	///Get the texture, to render it
+	Texture const& texture() const { return texture_; }
+	///Get SDL_Texture pointer
+	SDL_Texture* ptr() const { return texture_.ptr(); }
+
+	///Get texture format
+	Uint32 format() const { return format_->format; }
+	///Get texture pixel format
+	SDL_PixelFormat const& pixelformat() const { return *format_; }
+	///Get texture size
+	Vec2i size() const { return size_; }
+	///Get the number of bytes between two rows of the CPU copy
+	int pitch() const { return pitch_; }
+
+	///Get the CPU copy of the pixels. Call mark_dirty() on what you write
+	void* pixels() { return pixels_.data(); }
+	///Get the CPU copy of the pixels
+	void const* pixels() const { return pixels_.data(); }
+
+	///Get a typed view over the CPU copy. Throws if the texture isn't in the requested format
+	template<Uint32 Format>
+	PixelView<Format> view() const
+	{
+		if (format() != Format)
+		{
+			SDL_SetError(
+				"Cannot view a %s texture as %s",
+				SDL_GetPixelFormatName(format()),
+				SDL_GetPixelFormatName(Format));
+			throw Exception{"StreamingTexture::view"};
+		}
+
+		return PixelView<Format>{const_cast<Uint8*>(pixels_.data()), size_.x, size_.y, pitch_};
+	}
+
+	///Mark an area dirty, and get a typed view over it to write its pixels
+	template<Uint32 Format>
+	PixelView<Format> edit(Rect const& area)
+	{
+		const auto r = dirty_.bounds().inter(area);
+		auto	   v = view<Format>();
+		dirty_.add(r);
+		return v.subview(r.is_empty() ? Rect{} : r);
+	}
+
+	///Copy pixels in the texture format to an area
+	///\param pitch number of bytes between two rows of pixels
+	void update(Rect const& area, void const* pixels, int pitch)
+	{
+		const auto r = dirty_.bounds().inter(area);
+		if (r.is_empty()) return;
+
+		const auto bpp = format_->BytesPerPixel;
+		auto	   src
+			= static_cast<Uint8 const*>(pixels) + (r.y - area.y) * pitch + (r.x - area.x) * bpp;
+		for (int y = r.y1(); y < r.y2(); ++y, src += pitch)
+			std::memcpy(row(y) + r.x * bpp, src, size_t(r.w) * bpp);
+
+		dirty_.add(r);
+	}
+
+	///Fill an area with a color
+	void fill(Rect const& area, Color const& color)
+	{
+		const auto r = dirty_.bounds().inter(area);
+		if (r.is_empty()) return;
+
+		const auto bpp	 = format_->BytesPerPixel;
+		auto	   first = row(r.y) + r.x * bpp;
+
+		Pixel{first, *format_} = color;
+		for (int x = 1; x < r.w; ++x) std::memcpy(first + x * bpp, first, bpp);
+		for (int y = r.y1() + 1; y < r.y2(); ++y)
+			std::memcpy(row(y) + r.x * bpp, first, size_t(r.w) * bpp);
+
+		dirty_.add(r);
+	}
+
+	///Fill the whole texture with a color
+	void fill(Color const& color) { fill(dirty_.bounds(), color); }
+
+	///Mark an area as changed, so that the next upload() sends it
+	void mark_dirty(Rect const& area) { dirty_.add(area); }
+	///Mark the whole texture as changed, e.g. after the renderer lost its textures
+	void invalidate() { dirty_.add_all(); }
+	///Get the areas changed since the last upload()
+	DirtyRegion const& dirty() const { return dirty_; }
+
+	///Send every dirty area to the texture
+	void upload()
+	{
+		const auto bpp = format_->BytesPerPixel;
+		for (auto const& r : dirty_.rects())
+		{
+			if (SDL_UpdateTexture(texture_.ptr(), &r, row(r.y) + r.x * bpp, pitch_) != 0)
+				throw Exception{"SDL_UpdateTexture"};
+		}
+		dirty_.clear();
+	}
+
+private:
+	///Throw if a format has no bytes per pixel to speak of
+	static Uint32 checked_format(Uint32 format)
+	{
+		if (SDL_ISPIXELFORMAT_FOURCC(format))
+		{
+			SDL_SetError(
+				"StreamingTexture does not support the %s format", SDL_GetPixelFormatName(format));
+			throw Exception{"StreamingTexture"};
+		}
+		return format;
+	}
+
+	///Get a row of the CPU copy
+	Uint8* row(int y) { return pixels_.data() + std::ptrdiff_t(y) * pitch_; }
+
+	///The streaming texture
+	Texture texture_;
+	///Pixel format, owned by the process-wide format cache
+	SDL_PixelFormat const* format_;
+	///Texture size
+	Vec2i size_;
+	///Bytes between two rows of pixels_
+	int pitch_;
+	///CPU copy of the texture content
+	std::vector<Uint8> pixels_;
+	///Areas of pixels_ not uploaded yet
+	DirtyRegion dirty_;
+};
+
+} // namespace sdl
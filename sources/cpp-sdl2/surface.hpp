@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 #include <utility>
 
@@ -12,11 +14,105 @@
 #include "color.hpp"
 #include "exception.hpp"
 #include "pixel.hpp"
+#include "pixel_convert.hpp"
+#include "pixel_view.hpp"
 #include "rect.hpp"
+#include "thread_pool.hpp"
 #include "vec2.hpp"
 
 namespace sdl
 {
+namespace details
+{
+///\brief Clip a blit the way SDL_BlitSurface() does.
+///
+///src_rect (the whole source if null) is clipped to the source, then to the clip rect of the
+///destination once placed at dst_pos. Return false if nothing is left to draw.
+inline bool clip_blit(
+	SDL_Surface const* src,
+	SDL_Rect const*	   src_rect,
+	SDL_Surface const* dst,
+	Vec2i			   dst_pos,
+	Rect&			   src_out,
+	Vec2i&			   dst_out)
+{
+	Rect r = src_rect ? Rect{*src_rect} : Rect{0, 0, src->w, src->h};
+
+	if (r.x < 0)
+	{
+		r.w += r.x;
+		dst_pos.x -= r.x;
+		r.x = 0;
+	}
+	if (r.y < 0)
+	{
+		r.h += r.y;
+		dst_pos.y -= r.y;
+		r.y = 0;
+	}
+	r.w = std::min(r.w, src->w - r.x);
+	r.h = std::min(r.h, src->h - r.y);
+
+	auto const& clip = dst->clip_rect;
+	if (const int dx = clip.x - dst_pos.x; dx > 0)
+	{
+		r.w -= dx;
+		r.x += dx;
+		dst_pos.x += dx;
+	}
+	if (const int dy = clip.y - dst_pos.y; dy > 0)
+	{
+		r.h -= dy;
+		r.y += dy;
+		dst_pos.y += dy;
+	}
+	r.w = std::min(r.w, clip.x + clip.w - dst_pos.x);
+	r.h = std::min(r.h, clip.y + clip.h - dst_pos.y);
+
+	src_out = r;
+	dst_out = dst_pos;
+	return r.w > 0 && r.h > 0;
+}
+
+///Return true if two surfaces may share pixels
+inline bool surfaces_overlap(SDL_Surface const* a, SDL_Surface const* b)
+{
+	auto a0 = static_cast<Uint8 const*>(a->pixels);
+	auto b0 = static_cast<Uint8 const*>(b->pixels);
+	auto a1 = a0 + std::ptrdiff_t(a->pitch) * a->h;
+	auto b1 = b0 + std::ptrdiff_t(b->pitch) * b->h;
+	return a == b || (a0 < b1 && b0 < a1);
+}
+
+///Lock a surface that needs it (see SDL_MUSTLOCK) for the lifetime of this object, to read or
+///write its pixels directly
+class ScopedSurfaceLock
+{
+public:
+	///Lock the surface if it needs it
+	explicit ScopedSurfaceLock(SDL_Surface* surface)
+		: surface_{SDL_MUSTLOCK(surface) ? surface : nullptr}
+	{
+		if (surface_ && SDL_LockSurface(surface_) != 0) throw Exception{"SDL_LockSurface"};
+	}
+
+	///Unlock the surface
+	~ScopedSurfaceLock()
+	{
+		if (surface_) SDL_UnlockSurface(surface_);
+	}
+
+	///This is a scope guard. this object is not copyable
+	ScopedSurfaceLock(ScopedSurfaceLock const&) = delete;
+	///This is a scope guard. this object is not copyable
+	ScopedSurfaceLock& operator=(ScopedSurfaceLock const&) = delete;
+
+private:
+	///Surface locked, or nullptr
+	SDL_Surface* surface_;
+};
+} // namespace details
+
 ///Represent an SDL_Surface
 class Surface
 {
@@ -44,6 +140,22 @@ public:
 		///Get access to the raw array of pixels
 		void* raw_array() const { return surface_->pixels; }
 
+		///Get a typed view over the pixels. Throws if the surface isn't in the requested format
+		template<Uint32 Format>
+		PixelView<Format> view() const
+		{
+			if (surface_->format->format != Format)
+			{
+				SDL_SetError(
+					"Cannot view a %s surface as %s",
+					SDL_GetPixelFormatName(surface_->format->format),
+					SDL_GetPixelFormatName(Format));
+				throw Exception{"Surface::Lock::view"};
+			}
+
+			return PixelView<Format>{surface_->pixels, surface_->w, surface_->h, surface_->pitch};
+		}
+
 		///Free the lock
 		~Lock() { SDL_UnlockSurface(surface_); }
 
@@ -64,13 +176,25 @@ public:
 	{
 		if (surface_ != other.surface_)
 		{
-			SDL_FreeSurface(surface_);
+			if (owner_) SDL_FreeSurface(surface_);
+			SDL_FreeSurface(parent_);
 			surface_	   = other.surface_;
+			parent_		   = other.parent_;
+			owner_		   = other.owner_;
 			other.surface_ = nullptr;
+			other.parent_  = nullptr;
 		}
 		return *this;
 	}
 
+	///Construct a non-owning wrapper around a surface, that never frees it
+	static Surface non_owning(SDL_Surface* surface)
+	{
+		Surface s{surface};
+		s.owner_ = false;
+		return s;
+	}
+
 	///Create surface for given parameters
 	Surface(
 		Uint32 flags,
@@ -138,15 +262,62 @@ public:
 #endif
 
 	///RAII dtor to automatically free the surface
-	~Surface() { SDL_FreeSurface(surface_); }
+	~Surface()
+	{
+		if (owner_) SDL_FreeSurface(surface_);
+		SDL_FreeSurface(parent_);
+	}
 
 	///Get C SDL_Surface object
 	SDL_Surface* ptr() const { return surface_; }
 
+	///\brief Get a surface sharing the pixels of an area of this one, without copying them.
+	///
+	///The area is clipped to this surface. The subview starts with the blend mode, color and alpha
+	///mods, and color key of this surface, and can change them independently. It keeps this
+	///SDL_Surface alive (through its refcount) for as long as it exists, so it can outlive this
+	///object, but writing to either is visible in both. Throws for RLE surfaces and formats with
+	///less than 8 bits per pixel, whose areas can't be addressed directly.
+	Surface subview(Rect const& rect) const
+	{
+		if (SDL_MUSTLOCK(surface_) || surface_->format->BitsPerPixel < 8)
+		{
+			SDL_SetError(
+				"Cannot create a subview of a %s surface%s",
+				SDL_GetPixelFormatName(format()),
+				SDL_MUSTLOCK(surface_) ? " with RLE acceleration" : "");
+			throw Exception{"Surface::subview"};
+		}
+
+		auto r = Rect{0, 0, width(), height()}.inter(rect);
+		if (r.is_empty()) r = Rect{};
+
+		auto view = alias(r.x, r.y, r.w, r.h);
+		if (surface_->format->palette)
+		{
+			if (SDL_SetSurfacePalette(view.surface_, surface_->format->palette) != 0)
+				throw Exception{"SDL_SetSurfacePalette"};
+		}
+		view.set_blendmode(blendmode());
+		view.set_coloralphamod(coloralphamod());
+
+		Uint32 key;
+		if (SDL_GetColorKey(surface_, &key) == 0) view.set_colorkey(key);
+
+		view.parent_ = surface_;
+		++surface_->refcount;
+		return view;
+	}
+
+	///Return true if this surface shares the pixels of another one. See subview()
+	bool is_subview() const { return parent_ != nullptr; }
+
 	///Convert surface to given format
 	///\param format What pixel format to use
 	Surface with_format(SDL_PixelFormat const& format) const
 	{
+		if (!format.palette && can_convert_fast(format.format)) return with_format(format.format);
+
 		auto s = SDL_ConvertSurface(surface_, &format, 0);
 		if (!s) throw Exception{"SDL_ConvertSurface"};
 		return Surface{s};
@@ -156,15 +327,97 @@ public:
 	///\param format what format to use
 	Surface with_format(Uint32 format) const
 	{
+		if (can_convert_fast(format))
+		{
+			Surface s{0, width(), height(), int(SDL_BITSPERPIXEL(format)), format};
+			convert_pixels(
+				width(),
+				height(),
+				this->format(),
+				surface_->pixels,
+				surface_->pitch,
+				format,
+				s.surface_->pixels,
+				s.surface_->pitch);
+			copy_conversion_state(s);
+			return s;
+		}
+
 		auto s = SDL_ConvertSurfaceFormat(surface_, format, 0);
 		if (!s) throw Exception{"SDL_ConvertSurfaceFormat"};
 		return Surface{s};
 	}
 
+	///\brief Convert surface to given format, splitting rows across a thread pool.
+	///
+	///Conversions that involve a color key, color or alpha modulation, RLE, or an indexed or YUV
+	///format run on the calling thread.
+	Surface with_format(Uint32 format, ThreadPool& pool) const
+	{
+		if (!can_convert_pixels(format)) return with_format(format);
+
+		Surface s{0, width(), height(), int(SDL_BITSPERPIXEL(format)), format};
+		pool.parallel_for(
+			0,
+			height(),
+			[&](int y0, int y1) {
+				convert_pixels(
+					width(),
+					y1 - y0,
+					this->format(),
+					row(y0),
+					surface_->pitch,
+					format,
+					s.row(y0),
+					s.surface_->pitch);
+			},
+			details::min_rows_per_chunk(width() * std::max<int>(s.pixelformat().BytesPerPixel, 1)));
+		copy_conversion_state(s);
+		return s;
+	}
+
 	///Convert this surface to specified format
-	Surface& convert_to(SDL_PixelFormat const& format) { return *this = with_format(format); }
-	///Convert this surface to specified format
-	Surface& convert_to(Uint32 format) { return *this = with_format(format); }
+	Surface& convert_to(SDL_PixelFormat const& format)
+	{
+		if (!format.palette && can_convert_fast(format.format)) return convert_to(format.format);
+		return *this = with_format(format);
+	}
+
+	///\brief Convert this surface to specified format.
+	///
+	///When both formats have a fast path and the same number of bytes per pixel, and the pixels
+	///belong to this surface only, they are converted in place instead of being copied.
+	Surface& convert_to(Uint32 format)
+	{
+		if (!can_convert_in_place(format)) return *this = with_format(format);
+
+		// New header over the same pixels, then hand the ownership of the pixels over to it
+		Surface s{
+			surface_->pixels,
+			width(),
+			height(),
+			int(SDL_BITSPERPIXEL(format)),
+			surface_->pitch,
+			int(format)};
+		convert_pixels(
+			width(),
+			height(),
+			this->format(),
+			surface_->pixels,
+			surface_->pitch,
+			format,
+			surface_->pixels,
+			surface_->pitch);
+		copy_conversion_state(s);
+
+		s.surface_->flags &= ~Uint32(SDL_PREALLOC);
+#ifdef SDL_SIMD_ALIGNED
+		s.surface_->flags |= surface_->flags & SDL_SIMD_ALIGNED;
+#endif
+		surface_->flags |= SDL_PREALLOC;
+
+		return *this = std::move(s);
+	}
 
 #if SDL_VERSION_ATLEAST(2, 0, 9)
 	bool has_colorkey() const { return SDL_HasColorKey(surface_) == SDL_TRUE; }
@@ -191,6 +444,68 @@ public:
 		}
 	}
 
+	///\brief Blit surface on another, splitting rows across a thread pool.
+	///
+	///Small blits, and blits involving RLE, indexed surfaces or overlapping pixels run on the
+	///calling thread.
+	void blit_on(Rect const& src, Surface& surf, Rect const& dst, ThreadPool& pool) const
+	{
+		blit_parallel(&src, surf, dst, pool);
+	}
+
+	///Blit surface on another, splitting rows across a thread pool
+	void blit_on(Surface& surf, Rect const& dst, ThreadPool& pool) const
+	{
+		blit_parallel(nullptr, surf, dst, pool);
+	}
+
+	///Fill the surface with a color, within its clip rect
+	void fill(Color const& color) { fill(Rect{0, 0, width(), height()}, color); }
+
+	///Fill an area of the surface with a color, within its clip rect
+	void fill(Rect const& rect, Color const& color)
+	{
+		if (SDL_FillRect(surface_, &rect, color.as_uint(pixelformat())) != 0)
+			throw Exception{"SDL_FillRect"};
+	}
+
+	///Fill the surface with a color, splitting rows across a thread pool
+	void fill(Color const& color, ThreadPool& pool)
+	{
+		fill(Rect{0, 0, width(), height()}, color, pool);
+	}
+
+	///Fill an area of the surface with a color, splitting rows across a thread pool
+	void fill(Rect const& rect, Color const& color, ThreadPool& pool)
+	{
+		const auto raw = color.as_uint(pixelformat());
+		const auto r   = cliprect().inter(rect);
+		if (r.is_empty()) return;
+
+		pool.parallel_for(
+			r.y1(),
+			r.y2(),
+			[&](int y0, int y1) {
+				auto band = Rect{r.x, y0, r.w, y1 - y0};
+				if (SDL_FillRect(surface_, &band, raw) != 0) throw Exception{"SDL_FillRect"};
+			},
+			details::min_rows_per_chunk(r.w * surface_->format->BytesPerPixel));
+	}
+
+	///Write the surface to a BMP file
+	void save_bmp(std::string const& filename) const
+	{
+		if (SDL_SaveBMP(surface_, filename.c_str()) != 0) throw Exception{"SDL_SaveBMP"};
+	}
+
+#ifdef CPP_SDL2_ENABLE_SDL_IMAGE
+	///Write the surface to a PNG file, require SDL_Image
+	void save_png(std::string const& filename) const
+	{
+		if (IMG_SavePNG(surface_, filename.c_str()) != 0) throw Exception{"IMG_SavePNG"};
+	}
+#endif
+
 	///Get width of surface
 	int width() const { return surface_->w; }
 	///Get height of surface
@@ -316,8 +631,131 @@ public:
 	}
 
 private:
+	///\brief Return true if the pixels can be converted to format with convert_pixels().
+	///
+	///Both formats need a fast path, and nothing SDL's blitter would apply while converting (color
+	///key, color or alpha modulation, RLE) can be set on this surface.
+	bool can_convert_fast(Uint32 format) const
+	{
+		if (!has_fast_conversion(this->format(), format)) return false;
+		if (surface_->flags & SDL_RLEACCEL) return false;
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+		if (SDL_HasSurfaceRLE(surface_)) return false;
+#endif
+
+		Uint32 key;
+		if (SDL_GetColorKey(surface_, &key) == 0) return false;
+
+		Uint8 r = 0, g = 0, b = 0, a = 0;
+		SDL_GetSurfaceColorMod(surface_, &r, &g, &b);
+		SDL_GetSurfaceAlphaMod(surface_, &a);
+		return (r & g & b & a) == 255;
+	}
+
+	///Return true if convert_to(format) can reuse the pixels of this surface
+	bool can_convert_in_place(Uint32 format) const
+	{
+		return can_convert_fast(format)
+			   && SDL_BYTESPERPIXEL(format) == surface_->format->BytesPerPixel
+			   && surface_->refcount == 1 && !(surface_->flags & (SDL_PREALLOC | SDL_DONTFREE));
+	}
+
+	///Return true if the pixels can be converted to format with convert_pixels(), in any order
+	bool can_convert_pixels(Uint32 format) const
+	{
+		if (can_convert_fast(format)) return true;
+
+		for (auto f : {this->format(), format})
+			if (SDL_ISPIXELFORMAT_INDEXED(f) || SDL_ISPIXELFORMAT_FOURCC(f)) return false;
+		if (surface_->flags & SDL_RLEACCEL) return false;
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+		if (SDL_HasSurfaceRLE(surface_)) return false;
+#endif
+
+		Uint32 key;
+		if (SDL_GetColorKey(surface_, &key) == 0) return false;
+		return coloralphamod() == Color::White();
+	}
+
+	///Get a pointer to the first pixel of a row
+	Uint8* row(int y) const
+	{
+		return static_cast<Uint8*>(surface_->pixels) + std::ptrdiff_t(y) * surface_->pitch;
+	}
+
+	///Create a surface sharing the pixels of an area of this surface, with the same format
+	Surface alias(int x, int y, int w, int h) const
+	{
+		auto f = surface_->format;
+		return Surface{
+			row(y) + x * f->BytesPerPixel, w, h, f->BitsPerPixel, surface_->pitch, int(f->format)};
+	}
+
+	///Blit with row bands split across a thread pool. See blit_on()
+	void blit_parallel(
+		SDL_Rect const* src, Surface& dst, Rect const& dstrect, ThreadPool& pool) const
+	{
+		Rect  area;
+		Vec2i pos;
+		if (!details::clip_blit(surface_, src, dst.surface_, {dstrect.x, dstrect.y}, area, pos))
+			return;
+
+		const int  row_bytes = area.w * std::max(1, int(dst.surface_->format->BytesPerPixel));
+		const int  min_rows	 = details::min_rows_per_chunk(row_bytes);
+		const bool indexed	 = SDL_ISPIXELFORMAT_INDEXED(format())
+							 || SDL_ISPIXELFORMAT_INDEXED(dst.format());
+		if (area.h < 2 * min_rows || indexed || SDL_MUSTLOCK(surface_) || SDL_MUSTLOCK(dst.surface_)
+			|| details::surfaces_overlap(surface_, dst.surface_))
+		{
+			if (src)
+				blit_on(Rect{*src}, dst, dstrect);
+			else
+				blit_on(dst, dstrect);
+			return;
+		}
+
+		const auto mod	   = coloralphamod();
+		const auto bm	   = blendmode();
+		Uint32	   key	   = 0;
+		const bool has_key = SDL_GetColorKey(surface_, &key) == 0;
+
+		// SDL blits write to the source surface's blit map: each band needs its own source header
+		pool.parallel_for(
+			0,
+			area.h,
+			[&](int y0, int y1) {
+				auto s = alias(area.x, area.y + y0, area.w, y1 - y0);
+				auto d = dst.alias(pos.x, pos.y + y0, area.w, y1 - y0);
+				s.set_blendmode(bm);
+				s.set_coloralphamod(mod);
+				if (has_key) s.set_colorkey(key);
+
+				auto r = Rect{0, 0, area.w, y1 - y0};
+				if (SDL_LowerBlit(s.surface_, &r, d.surface_, &r) != 0)
+					throw Exception{"SDL_LowerBlit"};
+			},
+			min_rows);
+	}
+
+	///Give a converted surface the same clip rect and blend mode SDL_ConvertSurface() would
+	void copy_conversion_state(Surface& converted) const
+	{
+		SDL_SetClipRect(converted.surface_, &surface_->clip_rect);
+
+		auto bm = blendmode();
+		if (surface_->format->Amask && converted.surface_->format->Amask)
+			bm = SDL_BLENDMODE_BLEND;
+		else if (bm == SDL_BLENDMODE_BLEND)
+			bm = SDL_BLENDMODE_NONE;
+		converted.set_blendmode(bm);
+	}
+
 	///Set surface pointer
 	SDL_Surface* surface_ = nullptr;
+	///Surface whose pixels are used by this one, when created by subview()
+	SDL_Surface* parent_ = nullptr;
+	///False if surface_ is freed by someone else, see non_owning()
+	bool owner_ = true;
 };
 
 } // namespace sdl
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "SDL_version.h"
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+
+#include "exception.hpp"
+#include "pixel_convert.hpp"
+#include "simd.hpp"
+#include "surface.hpp"
+
+#include <SDL_surface.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace sdl
+{
+///\brief Cache of surfaces, to reuse the pixels of short lived surfaces of the same shape.
+///
+///acquire() hands out a PooledSurface, that gives its surface back to the pool when destroyed
+///instead of freeing it. Surfaces are recycled by (width, height, format), and their pixels are
+///allocated with sdl::simd::allocator, with every row aligned for SIMD. The content of a recycled
+///surface is whatever was last written to it. A pool can be used from several threads, and can be
+///destroyed before the surfaces it handed out.
+class SurfacePool
+{
+	///Shape of the surfaces kept together
+	struct Key
+	{
+		int	   w;
+		int	   h;
+		Uint32 format;
+
+		bool operator==(Key const& o) const { return w == o.w && h == o.h && format == o.format; }
+	};
+
+	///Hash a Key
+	struct KeyHash
+	{
+		size_t operator()(Key const& k) const
+		{
+			const auto shape = Uint64(Uint32(k.w)) << 32 | Uint32(k.h);
+			return std::hash<Uint64>{}(shape ^ (Uint64(k.format) << 16));
+		}
+	};
+
+	///State shared by the pool and its handles
+	struct State
+	{
+		///Protect free
+		std::mutex mutex;
+		///Surfaces ready to be handed out
+		std::unordered_map<Key, std::vector<Surface>, KeyHash> free;
+		///Maximum number of surfaces kept per shape
+		size_t max_per_shape;
+	};
+
+public:
+	///Surface borrowed from a pool. The surface goes back to the pool when this is destroyed
+	class PooledSurface
+	{
+		friend class SurfacePool;
+
+	public:
+		///Empty handle
+		PooledSurface() = default;
+
+		///Give the surface back to its pool
+		~PooledSurface() { reset(); }
+
+		///Move the surface into this handle
+		PooledSurface(PooledSurface&& other) noexcept { *this = std::move(other); }
+
+		///Move the surface into this handle, giving back the one held before
+		PooledSurface& operator=(PooledSurface&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				surface_ = std::move(other.surface_);
+				pool_	 = std::move(other.pool_);
+				key_	 = other.key_;
+			}
+			return *this;
+		}
+
+		///Access the surface
+		Surface& operator*() { return surface_; }
+		///Access the surface
+		Surface const& operator*() const { return surface_; }
+		///Access the surface
+		Surface* operator->() { return &surface_; }
+		///Access the surface
+		Surface const* operator->() const { return &surface_; }
+
+		///Get the surface
+		Surface& get() { return surface_; }
+		///Get the surface
+		Surface const& get() const { return surface_; }
+
+		///Return true if this handle holds a surface
+		explicit operator bool() const { return surface_.ptr() != nullptr; }
+
+		///Take the surface out of the pool for good. The handle is left empty
+		Surface release()
+		{
+			pool_.reset();
+			return std::move(surface_);
+		}
+
+		///Give the surface back to its pool now. The handle is left empty
+		void reset()
+		{
+			auto state = pool_.lock();
+			pool_.reset();
+			if (state) recycle(*state, key_, std::move(surface_));
+			surface_ = Surface{nullptr};
+		}
+
+	private:
+		///Create a handle. Only pools create handles
+		PooledSurface(Surface&& surface, std::weak_ptr<State> pool, Key key)
+			: surface_{std::move(surface)}, pool_{std::move(pool)}, key_{key}
+		{
+		}
+
+		///The borrowed surface
+		Surface surface_{nullptr};
+		///Where the surface goes back
+		std::weak_ptr<State> pool_;
+		///Shape the surface was created with
+		Key key_ = {0, 0, SDL_PIXELFORMAT_UNKNOWN};
+	};
+
+	///Create a pool keeping at most max_per_shape unused surfaces of each shape
+	explicit SurfacePool(size_t max_per_shape = 8) : state_{std::make_shared<State>()}
+	{
+		state_->max_per_shape = max_per_shape;
+	}
+
+	///Get a surface of the given shape, recycled if possible. Its pixels are left as they are
+	PooledSurface acquire(int w, int h, Uint32 format)
+	{
+		const auto key = Key{w, h, format};
+		{
+			std::lock_guard<std::mutex> lock{state_->mutex};
+			auto						it = state_->free.find(key);
+			if (it != state_->free.end() && !it->second.empty())
+			{
+				auto surface = std::move(it->second.back());
+				it->second.pop_back();
+				return PooledSurface{std::move(surface), state_, key};
+			}
+		}
+		return PooledSurface{create(w, h, format), state_, key};
+	}
+
+	///Get a surface of the given shape, recycled if possible. Its pixels are left as they are
+	PooledSurface acquire(Vec2i size, Uint32 format) { return acquire(size.x, size.y, format); }
+
+	///\brief Get a surface holding the pixels of src converted to format, like SDL_ConvertPixels().
+	///
+	///Only pixels are converted: the color key, color mod and alpha mod of src don't apply.
+	PooledSurface acquire_converted(Surface const& src, Uint32 format)
+	{
+		auto dst = acquire(src.width(), src.height(), format);
+		auto s	 = src.ptr();
+
+		details::ScopedSurfaceLock lock{s};
+		convert_pixels(
+			s->w,
+			s->h,
+			s->format->format,
+			s->pixels,
+			s->pitch,
+			format,
+			dst->ptr()->pixels,
+			dst->ptr()->pitch);
+
+		return dst;
+	}
+
+	///Free every unused surface
+	void trim()
+	{
+		std::lock_guard<std::mutex> lock{state_->mutex};
+		state_->free.clear();
+	}
+
+	///Get the number of unused surfaces kept
+	size_t cached() const
+	{
+		std::lock_guard<std::mutex> lock{state_->mutex};
+		size_t						n = 0;
+		for (auto const& entry : state_->free) n += entry.second.size();
+		return n;
+	}
+
+private:
+	///Allocate a surface with SIMD aligned rows, owned by SDL like any other surface
+	static Surface create(int w, int h, Uint32 format)
+	{
+		const auto align = std::max<size_t>(simd::get_alignment(), 4);
+		const auto row	 = size_t(w) * SDL_BYTESPERPIXEL(format);
+		const auto pitch = (row + align - 1) / align * align;
+
+		auto pixels = simd::allocator<Uint8>{}.allocate(std::max<size_t>(pitch * size_t(h), 1));
+		if (!pixels)
+		{
+			SDL_OutOfMemory();
+			throw Exception{"SurfacePool::acquire"};
+		}
+
+		auto s = SDL_CreateRGBSurfaceWithFormatFrom(
+			pixels, w, h, SDL_BITSPERPIXEL(format), int(pitch), format);
+		if (!s)
+		{
+			simd::free(pixels);
+			throw Exception{"SDL_CreateRGBSurfaceWithFormatFrom"};
+		}
+
+		// SDL_FreeSurface() frees pixels flagged SDL_SIMD_ALIGNED with SDL_SIMDFree()
+		s->flags = (s->flags & ~Uint32(SDL_PREALLOC)) | SDL_SIMD_ALIGNED;
+		return Surface{s};
+	}
+
+	///Reset a returned surface, and keep it if it can be handed out again
+	static void recycle(State& state, Key key, Surface&& surface)
+	{
+		auto s = surface.ptr();
+		if (!s || surface.is_subview()) return;
+
+		// Surfaces still referenced elsewhere (e.g. by a subview), or reshaped, are just freed
+		if (s->refcount != 1 || s->w != key.w || s->h != key.h || s->format->format != key.format
+			|| (s->flags & (SDL_PREALLOC | SDL_RLEACCEL)))
+		{
+			return;
+		}
+
+		SDL_SetSurfaceRLE(s, 0);
+		SDL_SetColorKey(s, SDL_FALSE, 0);
+		SDL_SetSurfaceColorMod(s, 255, 255, 255);
+		SDL_SetSurfaceAlphaMod(s, 255);
+		SDL_SetSurfaceBlendMode(s, s->format->Amask ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+		SDL_SetClipRect(s, nullptr);
+
+		std::lock_guard<std::mutex> lock{state.mutex};
+		auto&						bucket = state.free[key];
+		if (bucket.size() < state.max_per_shape) bucket.push_back(std::move(surface));
+	}
+
+	///State shared with handles
+	std::shared_ptr<State> state_;
+};
+
+///Surface borrowed from a SurfacePool
+using PooledSurface = SurfacePool::PooledSurface;
+
+} // namespace sdl
+
+#endif // SDL_VERSION_ATLEAST(2, 0, 10)
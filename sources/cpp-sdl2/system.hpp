@@ -0,0 +1,153 @@
+#pragma once
+
+#include <SDL.h>
+#include <SDL_cpuinfo.h>
+#include <string>
+
+// Kernels that are hand-written for a specific x86 instruction set are compiled with the matching
+// target attribute, and selected at runtime from what the CPU reports. MSVC doesn't need (nor
+// support) the attribute to emit those instructions.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPP_SDL2_X86_DISPATCH
+#define CPP_SDL2_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define CPP_SDL2_X86_DISPATCH
+#define CPP_SDL2_TARGET(isa)
+#endif
+
+namespace sdl
+{
+///Get information about the system (os, cpu, ram...)
+namespace system
+{
+// new in 2.0.9
+#if SDL_VERSION_ATLEAST(2, 0, 9)
+inline bool is_tablet()
+{
+	return SDL_IsTablet();
+}
+
+inline bool has_AVX512F()
+{
+	return SDL_HasAVX512F();
+}
+#endif
+
+///Get used platform as a string
+inline std::string platform()
+{
+	return SDL_GetPlatform();
+}
+
+///Get the size of a cacheline
+/// \return size of "L1" cache, in bytes
+inline int cpu_cacheline_size()
+{
+	return SDL_GetCPUCacheLineSize();
+}
+
+///Get the numbers of CPU in the system
+inline int cpu_count()
+{
+	return SDL_GetCPUCount();
+}
+
+///Get the amount of ram in the system
+///`\return amount of RAM in MB
+inline int system_ram()
+{
+	return SDL_GetSystemRAM();
+}
+
+///Returns true if system has AMD 3DNow! support
+inline bool has_3DNow()
+{
+	return SDL_Has3DNow();
+}
+
+///Return true if CPU has AVX instruction set support
+inline bool has_AVX()
+{
+	return SDL_HasAVX();
+}
+
+///Return true if CPU has AVX2 instruction set support
+inline bool has_AVX2()
+{
+	return SDL_HasAVX2();
+}
+
+///Return true if cpu has Apple/IBM/Motorola AltiVec SIMD support
+inline bool has_AltiVec()
+{
+	return SDL_HasAltiVec();
+}
+
+///Return true if cpu has Intel MMX support
+inline bool has_MMX()
+{
+	return SDL_HasMMX();
+}
+
+///Return true if current cpu has a TSC register
+inline bool has_RDTSC()
+{
+	return SDL_HasRDTSC();
+}
+
+///Return true if cpu supports 1st gen SSE
+inline bool has_SSE()
+{
+	return SDL_HasSSE();
+}
+
+///Return true if cpu supports SSE2
+inline bool has_SSE2()
+{
+	return SDL_HasSSE2();
+}
+
+///Return true if cpu supports SSE3
+inline bool has_SSE3()
+{
+	return SDL_HasSSE3();
+}
+
+///Return true if cpu supports SSE41
+inline bool has_SSE41()
+{
+	return SDL_HasSSE41();
+}
+
+///Return true if cpu supports SSE42
+inline bool has_SSE42()
+{
+	return SDL_HasSSE42();
+}
+} // namespace system
+
+namespace details
+{
+///Instruction sets a kernel can be dispatched to, from the least to the most capable
+enum class SimdLevel
+{
+	scalar,
+	sse41,
+	avx2
+};
+
+///Get the best instruction set usable by the running CPU. Computed once
+inline SimdLevel simd_level()
+{
+#ifdef CPP_SDL2_X86_DISPATCH
+	static const SimdLevel level = system::has_AVX2() ? SimdLevel::avx2
+								   : system::has_SSE41() ? SimdLevel::sse41
+														 : SimdLevel::scalar;
+	return level;
+#else
+	return SimdLevel::scalar;
+#endif
+}
+} // namespace details
+
+} // namespace sdl
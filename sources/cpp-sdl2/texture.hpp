@@ -3,6 +3,8 @@
 #include "color.hpp"
 #include "exception.hpp"
 #include "pixel.hpp"
+#include "pixel_format.hpp"
+#include "pixel_view.hpp"
 #include "rect.hpp"
 #include "surface.hpp"
 #include "vec2.hpp"
@@ -13,6 +15,14 @@
 
 namespace sdl
 {
+///Number of state changes sent to SDL, and of changes skipped as redundant, by a Renderer or a
+///Texture
+struct StateStats
+{
+	Uint64 issued  = 0;
+	Uint64 skipped = 0;
+};
+
 ///Class that represet a renderer texture
 class Texture
 {
@@ -36,27 +46,40 @@ public:
 		///Get pixel at location with operator[]
 		Pixel operator[](Vec2i const& pos) const { return at(pos.x, pos.y); }
 
-		///Automatically unlock texture
-		~Lock()
+		///Get a typed view over the locked pixels. Throws if the texture isn't in the requested format
+		template<Uint32 Format>
+		PixelView<Format> view() const
 		{
-			SDL_UnlockTexture(texture_);
-			SDL_FreeFormat(format_);
+			if (format_->format != Format)
+			{
+				SDL_SetError(
+					"Cannot view a %s texture as %s",
+					SDL_GetPixelFormatName(format_->format),
+					SDL_GetPixelFormatName(Format));
+				throw Exception{"Texture::Lock::view"};
+			}
+
+			return PixelView<Format>{pixels_, width_, height_, pitch_};
 		}
 
+		///Get the size of the locked area
+		Vec2i size() const { return Vec2i{width_, height_}; }
+
+		///Automatically unlock texture
+		~Lock() { SDL_UnlockTexture(texture_); }
+
 	private:
 		///private ctor to create a lock. Lock are created by Texture class
-		Lock(SDL_Texture* texture, SDL_Rect const* rect) : texture_{texture}
+		Lock(SDL_Texture* texture, SDL_Rect const* rect, SDL_PixelFormat const& format, Vec2i size)
+			: texture_{texture}
+			, width_{rect ? rect->w : size.x}
+			, height_{rect ? rect->h : size.y}
+			, format_{&format}
 		{
 			if (SDL_LockTexture(texture_, rect, &pixels_, &pitch_) != 0)
 			{
 				throw Exception{"SDL_LockTexture"};
 			}
-
-			Uint32 f;
-			SDL_QueryTexture(texture_, &f, nullptr, nullptr, nullptr);
-			format_ = SDL_AllocFormat(f);
-
-			if (!format_) throw Exception{"SDL_AllocFormat"};
 		}
 
 		///pointer to raw texure
@@ -65,8 +88,12 @@ public:
 		void* pixels_;
 		///Pixel pitch
 		int pitch_;
-		///Pixel format
-		SDL_PixelFormat* format_;
+		///Width of the locked area
+		int width_;
+		///Height of the locked area
+		int height_;
+		///Pixel format, owned by the process-wide format cache
+		SDL_PixelFormat const* format_;
 	};
 
 	///Construct texture from C SDL_Texture object
@@ -113,7 +140,13 @@ public:
 		{
 			SDL_DestroyTexture(texture_);
 			texture_	   = other.texture_;
+			info_		   = other.info_;
+			mods_		   = other.mods_;
+			stats_		   = other.stats_;
 			other.texture_ = nullptr;
+			other.info_	   = {};
+			other.mods_	   = {};
+			other.stats_   = {};
 		}
 
 		return *this;
@@ -127,51 +160,108 @@ public:
 	///Destroy texture when it's not in use anymore
 	~Texture() { SDL_DestroyTexture(texture_); }
 
-	///Set texture blend mode
+	///Set texture blend mode. Nothing is sent to SDL if it is already the blend mode
 	void set_blendmode(SDL_BlendMode const& bm) const
 	{
-		if (SDL_SetTextureBlendMode(texture_, bm) != 0) throw Exception{"SDL_SetTextureBlendMode"};
+		if (!try_set_blendmode(bm)) throw Exception{"SDL_SetTextureBlendMode"};
+	}
+
+	///Set texture blend mode, or return false if the renderer doesn't support it (e.g. a custom
+	///blend mode made by SDL_ComposeCustomBlendMode())
+	bool try_set_blendmode(SDL_BlendMode const& bm) const
+	{
+		if (mods_.blend_known && mods_.blend == bm)
+		{
+			++stats_.skipped;
+			return true;
+		}
+
+		if (SDL_SetTextureBlendMode(texture_, bm) != 0) return false;
+		mods_.blend		  = bm;
+		mods_.blend_known = true;
+		++stats_.issued;
+		return true;
 	}
 	///Get texture blend mode
 	SDL_BlendMode blendmode() const
 	{
-		SDL_BlendMode bm;
-		if (SDL_GetTextureBlendMode(texture_, &bm) != 0) throw Exception{"SDL_GetTextureBlendMode"};
-		return bm;
+		if (!mods_.blend_known)
+		{
+			if (SDL_GetTextureBlendMode(texture_, &mods_.blend) != 0)
+				throw Exception{"SDL_GetTextureBlendMode"};
+			mods_.blend_known = true;
+		}
+		return mods_.blend;
 	}
 
 	///Set colormod
 	void set_colormod(Color const& color) const { set_colormod(color.r, color.g, color.b); }
-	///Set colormod
+	///Set colormod. Nothing is sent to SDL if it is already the colormod
 	void set_colormod(Uint8 r, Uint8 g, Uint8 b) const
 	{
+		const auto& c = mods_.color;
+		if (mods_.color_known && c.r == r && c.g == g && c.b == b)
+		{
+			++stats_.skipped;
+			return;
+		}
+
 		if (SDL_SetTextureColorMod(texture_, r, g, b) != 0)
 			throw Exception{"SDL_SetTextureColorMod"};
+		mods_.color		  = Color{r, g, b};
+		mods_.color_known = true;
+		++stats_.issued;
 	}
 
 	///Get colormod
 	Color colormod() const
 	{
-		Color c;
-		if (SDL_GetTextureColorMod(texture_, &c.r, &c.g, &c.b) != 0)
-			throw Exception{"SDL_SetTextureColorMod"};
-		return c;
+		if (!mods_.color_known)
+		{
+			auto& c = mods_.color;
+			if (SDL_GetTextureColorMod(texture_, &c.r, &c.g, &c.b) != 0)
+				throw Exception{"SDL_GetTextureColorMod"};
+			mods_.color_known = true;
+		}
+		return Color{mods_.color.r, mods_.color.g, mods_.color.b};
 	}
 
-	///Set alphamod
+	///Set alphamod. Nothing is sent to SDL if it is already the alphamod
 	void set_alphamod(Uint8 alpha) const
 	{
+		if (mods_.alpha_known && mods_.alpha == alpha)
+		{
+			++stats_.skipped;
+			return;
+		}
+
 		if (SDL_SetTextureAlphaMod(texture_, alpha) != 0) throw Exception{"SDL_SetTextureAlphaMod"};
+		mods_.alpha		  = alpha;
+		mods_.alpha_known = true;
+		++stats_.issued;
 	}
 	///Set alphamod
 	Uint8 alphamod() const
 	{
-		Uint8 alpha;
-		if (SDL_GetTextureAlphaMod(texture_, &alpha) != 0)
-			throw Exception{"SDL_GetTextureAlphaMod"};
-		return alpha;
+		if (!mods_.alpha_known)
+		{
+			if (SDL_GetTextureAlphaMod(texture_, &mods_.alpha) != 0)
+				throw Exception{"SDL_GetTextureAlphaMod"};
+			mods_.alpha_known = true;
+		}
+		return mods_.alpha;
 	}
 
+	///Forget the remembered blend mode and mods. Call it after changing them through ptr()
+	void invalidate_mods() const { mods_ = {}; }
+
+	///Get the number of blend mode and mod changes sent to SDL and skipped since creation or
+	///reset_state_stats()
+	StateStats const& state_stats() const { return stats_; }
+
+	///Reset the blend mode and mod change counters
+	void reset_state_stats() const { stats_ = {}; }
+
 	///Set coloralphamod
 	void set_coloralphamod(Uint8 r, Uint8 g, Uint8 b, Uint8 a) const
 	{
@@ -193,40 +283,73 @@ public:
 	}
 
 	///Get texture format
-	Uint32 format() const
+	Uint32 format() const { return info().format; }
+
+	///Get texture pixel format, shared with the process-wide format cache
+	SDL_PixelFormat const& pixelformat() const
 	{
-		Uint32 f;
-		if (SDL_QueryTexture(texture_, &f, nullptr, nullptr, nullptr) != 0)
-			throw Exception{"SDL_QueryTexture"};
-		return f;
+		if (!info().pixelformat) info_.pixelformat = &PixelFormat::get(info_.format);
+		return *info_.pixelformat;
 	}
 
 	///Access texture
-	int access() const
-	{
-		int a;
-		if (SDL_QueryTexture(texture_, nullptr, &a, nullptr, nullptr) != 0)
-			throw Exception{"SDL_QueryTexture"};
-		return a;
-	}
+	int access() const { return info().access; }
 
 	///Get texture size
-	Vec2i size() const
-	{
-		Vec2i s;
-		if (SDL_QueryTexture(texture_, nullptr, nullptr, &s.x, &s.y) != 0)
-			throw Exception{"SDL_QueryTexture"};
-		return s;
-	}
+	Vec2i size() const { return info().size; }
 
 	///lock texture for direct access to content
-	[[nodiscard]] Lock lock() { return Lock{texture_, nullptr}; }
+	[[nodiscard]] Lock lock() { return Lock{texture_, nullptr, pixelformat(), size()}; }
 
 	///lock texture rect
-	[[nodiscard]] Lock lock(Rect const& rect) { return Lock{texture_, &rect}; }
+	[[nodiscard]] Lock lock(Rect const& rect)
+	{
+		return Lock{texture_, &rect, pixelformat(), size()};
+	}
 
 private:
+	///Texture properties. They can't change during the texture lifetime, so they are queried once
+	struct Info
+	{
+		Uint32				   format	   = SDL_PIXELFORMAT_UNKNOWN;
+		int					   access	   = 0;
+		Vec2i				   size		   = {};
+		SDL_PixelFormat const* pixelformat = nullptr;
+	};
+
+	///Get texture properties, querying them on first use
+	Info const& info() const
+	{
+		if (info_.format == SDL_PIXELFORMAT_UNKNOWN)
+		{
+			if (SDL_QueryTexture(texture_, &info_.format, &info_.access, &info_.size.x, &info_.size.y)
+				!= 0)
+			{
+				info_ = {};
+				throw Exception{"SDL_QueryTexture"};
+			}
+		}
+		return info_;
+	}
+
+	///Blend mode and mods last set through this object. Unknown values are queried when needed
+	struct Mods
+	{
+		bool		  blend_known = false;
+		SDL_BlendMode blend		  = SDL_BLENDMODE_NONE;
+		bool		  color_known = false;
+		Color		  color;
+		bool		  alpha_known = false;
+		Uint8		  alpha		  = 255;
+	};
+
 	SDL_Texture* texture_ = nullptr;
+	///Cached texture properties
+	mutable Info info_;
+	///Remembered blend mode and mods
+	mutable Mods mods_;
+	///Blend mode and mod changes counters
+	mutable StateStats stats_;
 };
 
 } // namespace sdl
@@ -0,0 +1,362 @@
+#pragma once
+
+#include "exception.hpp"
+#include "rect.hpp"
+#include "surface.hpp"
+#include "texture.hpp"
+#include "vec2.hpp"
+
+#include <SDL_render.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sdl
+{
+///\brief Packer of rectangles into a fixed size area, using the skyline bottom-left heuristic.
+///
+///The packer keeps the top edge of the packed area as a list of horizontal segments, and puts each
+///rect where its top ends up the lowest. Space freed by removing rects can only be reused by
+///starting over with clear().
+class SkylinePacker
+{
+public:
+	///Create a packer for an area of the given size
+	explicit SkylinePacker(Vec2i size = {}) : size_{size} { clear(); }
+
+	///Get the size of the packed area
+	Vec2i size() const { return size_; }
+
+	///Forget every packed rect
+	void clear()
+	{
+		skyline_.clear();
+		skyline_.push_back({0, 0, size_.x});
+		used_ = 0;
+	}
+
+	///Get the number of pixels covered by the packed rects
+	long long used() const { return used_; }
+
+	///Find room for a rect of the given size
+	///\param out set to the position and size of the rect, when there is room for it
+	///\return false if the rect doesn't fit anywhere
+	bool pack(Vec2i size, Rect& out)
+	{
+		if (size.x <= 0 || size.y <= 0) return false;
+
+		size_t best	  = skyline_.size();
+		int	   best_y = 0, best_top = 0, best_w = 0;
+		for (size_t i = 0; i < skyline_.size(); ++i)
+		{
+			int y;
+			if (!fit(i, size, y)) continue;
+
+			const auto top = y + size.y;
+			if (best == skyline_.size() || top < best_top
+				|| (top == best_top && skyline_[i].w < best_w))
+			{
+				best	 = i;
+				best_y	 = y;
+				best_top = top;
+				best_w	 = skyline_[i].w;
+			}
+		}
+		if (best == skyline_.size()) return false;
+
+		out = Rect{skyline_[best].x, best_y, size.x, size.y};
+		raise(best, out);
+		used_ += (long long)size.x * size.y;
+		return true;
+	}
+
+private:
+	///Horizontal segment of the top edge of the packed area
+	struct Segment
+	{
+		int x, y, w;
+	};
+
+	///Check if a rect fits with its left side on segment i, and get the y it lands at
+	bool fit(size_t i, Vec2i size, int& y) const
+	{
+		const auto x = skyline_[i].x;
+		if (x + size.x > size_.x) return false;
+
+		y = 0;
+		for (auto left = size.x; left > 0; ++i)
+		{
+			y = std::max(y, skyline_[i].y);
+			if (y + size.y > size_.y) return false;
+			left -= skyline_[i].w;
+		}
+		return true;
+	}
+
+	///Put a rect on the skyline at segment i
+	void raise(size_t i, Rect const& r)
+	{
+		skyline_.insert(skyline_.begin() + std::ptrdiff_t(i), {r.x, r.y + r.h, r.w});
+
+		// Shorten or remove the segments now under the rect
+		const auto right = r.x + r.w;
+		for (auto j = i + 1; j < skyline_.size();)
+		{
+			auto& s = skyline_[j];
+			if (s.x >= right) break;
+
+			const auto cut = right - s.x;
+			if (cut < s.w)
+			{
+				s.x += cut;
+				s.w -= cut;
+				break;
+			}
+			skyline_.erase(skyline_.begin() + std::ptrdiff_t(j));
+		}
+
+		// Merge neighbours at the same height
+		for (size_t j = 0; j + 1 < skyline_.size();)
+		{
+			if (skyline_[j].y == skyline_[j + 1].y)
+			{
+				skyline_[j].w += skyline_[j + 1].w;
+				skyline_.erase(skyline_.begin() + std::ptrdiff_t(j + 1));
+			}
+			else
+			{
+				++j;
+			}
+		}
+	}
+
+	///Size of the packed area
+	Vec2i size_;
+	///Top edge of the packed area, from left to right
+	std::vector<Segment> skyline_;
+	///Number of pixels covered by packed rects
+	long long used_ = 0;
+};
+
+///\brief Set of images packed into a few large textures, so that drawing them rarely changes
+///texture.
+///
+///Images are converted to the atlas format, and packed with a SkylinePacker into pages of a fixed
+///size, a new page being made when no page has room left. Each image is given an id, that stays
+///valid until it is erased, even through repack(). A CPU copy of every image is kept, so the
+///pages can be rebuilt: repack() reclaims the room of erased images, and also restores the pages
+///after the renderer lost its textures.
+class TextureAtlas
+{
+public:
+	///Identifier of an image in the atlas
+	using Id = Uint32;
+
+	///Where an image is in the atlas. Valid until the next insert(), erase() or repack()
+	struct Region
+	{
+		///Page holding the image
+		Texture const* texture;
+		///Position and size of the image in the page
+		Rect rect;
+	};
+
+	///Create an empty atlas
+	///\param page_size size of the textures images are packed in
+	///\param padding number of empty pixels kept between images, so that filtering doesn't bleed
+	TextureAtlas(
+		SDL_Renderer* renderer,
+		Vec2i		  page_size = {2048, 2048},
+		Uint32		  format	= SDL_PIXELFORMAT_ARGB8888,
+		int			  padding	= 1)
+		: renderer_{renderer}, page_size_{page_size}, format_{format}, padding_{padding}
+	{
+	}
+
+	///Add an image to the atlas, and get its id. Throws if it is empty or larger than a page
+	Id insert(Surface const& image)
+	{
+		if (image.width() <= 0 || image.height() <= 0)
+		{
+			SDL_SetError("Cannot insert an empty image in a texture atlas");
+			throw Exception{"TextureAtlas::insert"};
+		}
+		if (image.width() + padding_ > page_size_.x || image.height() + padding_ > page_size_.y)
+		{
+			SDL_SetError(
+				"Image of %dx%d is too large for atlas pages of %dx%d",
+				image.width(),
+				image.height(),
+				page_size_.x,
+				page_size_.y);
+			throw Exception{"TextureAtlas::insert"};
+		}
+
+		Id id;
+		if (free_ids_.empty())
+		{
+			id = Id(entries_.size());
+			entries_.push_back({});
+		}
+		else
+		{
+			id = free_ids_.back();
+			free_ids_.pop_back();
+		}
+
+		auto& e = entries_[id];
+		e.image = image.with_format(format_);
+		e.live	= true;
+		place(e);
+		return id;
+	}
+
+	///Remove an image. Its room is reclaimed by the next repack()
+	void erase(Id id)
+	{
+		auto& e = entry(id);
+		pages_[size_t(e.page)]->used -= area(e);
+		e = {};
+		free_ids_.push_back(id);
+	}
+
+	///Get where an image is
+	Region region(Id id) const
+	{
+		auto const& e = entry(id);
+		return {&pages_[size_t(e.page)]->texture, e.rect};
+	}
+
+	///Get the page holding an image
+	Texture const& texture(Id id) const { return *region(id).texture; }
+	///Get the position and size of an image in its page
+	Rect rect(Id id) const { return entry(id).rect; }
+
+	///Get the number of images
+	size_t size() const { return entries_.size() - free_ids_.size(); }
+	///Get the number of pages
+	size_t pages() const { return pages_.size(); }
+	///Get the fraction of the pages area covered by images
+	double occupancy() const
+	{
+		if (pages_.empty()) return 0.;
+		long long used = 0;
+		for (auto const& p : pages_) used += p->used;
+		return double(used) / (double(page_size_.x) * page_size_.y * double(pages_.size()));
+	}
+
+	///Pack every image again from scratch, tallest first, in as few pages as possible, and upload
+	///them again. Ids are kept
+	void repack()
+	{
+		std::vector<Id> order;
+		for (Id id = 0; id < entries_.size(); ++id)
+			if (entries_[id].live) order.push_back(id);
+
+		std::stable_sort(order.begin(), order.end(), [&](Id a, Id b) {
+			return entries_[a].image.height() > entries_[b].image.height();
+		});
+
+		pages_.clear();
+		for (auto id : order) place(entries_[id]);
+	}
+
+private:
+	///Texture images are packed in
+	struct Page
+	{
+		Texture		  texture;
+		SkylinePacker packer;
+		///Number of pixels covered by live images
+		long long used;
+	};
+
+	///An image in the atlas
+	struct Entry
+	{
+		///CPU copy of the image, in the atlas format
+		Surface image{nullptr};
+		int		page = -1;
+		Rect	rect;
+		bool	live = false;
+	};
+
+	///Get a live entry, throw if id isn't one
+	Entry const& entry(Id id) const
+	{
+		if (id >= entries_.size() || !entries_[id].live)
+		{
+			SDL_SetError("Invalid texture atlas id %u", unsigned(id));
+			throw Exception{"TextureAtlas"};
+		}
+		return entries_[id];
+	}
+
+	///Get a live entry, throw if id isn't one
+	Entry& entry(Id id)
+	{
+		return const_cast<Entry&>(static_cast<TextureAtlas const&>(*this).entry(id));
+	}
+
+	///Number of pixels of an image
+	static long long area(Entry const& e) { return (long long)e.rect.w * e.rect.h; }
+
+	///Find room for an image in the first page that has some, and upload it there
+	void place(Entry& e)
+	{
+		const auto size = Vec2i{e.image.width() + padding_, e.image.height() + padding_};
+
+		Rect   r;
+		size_t page = 0;
+		while (page < pages_.size() && !pages_[page]->packer.pack(size, r)) ++page;
+		if (page == pages_.size())
+		{
+			add_page();
+			pages_.back()->packer.pack(size, r);
+		}
+
+		e.page = int(page);
+		e.rect = Rect{r.x, r.y, e.image.width(), e.image.height()};
+		pages_[page]->used += area(e);
+
+		auto s = e.image.ptr();
+		if (e.rect.w > 0 && e.rect.h > 0
+			&& SDL_UpdateTexture(pages_[page]->texture.ptr(), &e.rect, s->pixels, s->pitch) != 0)
+			throw Exception{"SDL_UpdateTexture"};
+	}
+
+	///Make a new page, cleared so that padding pixels are transparent
+	void add_page()
+	{
+		auto texture = Texture{renderer_, format_, SDL_TEXTUREACCESS_STATIC, page_size_};
+		texture.set_blendmode(SDL_BLENDMODE_BLEND);
+
+		const auto pitch = page_size_.x * SDL_BYTESPERPIXEL(format_);
+		const auto zeros = std::vector<Uint8>(size_t(pitch) * size_t(page_size_.y));
+		if (SDL_UpdateTexture(texture.ptr(), nullptr, zeros.data(), pitch) != 0)
+			throw Exception{"SDL_UpdateTexture"};
+
+		pages_.push_back(
+			std::unique_ptr<Page>{new Page{std::move(texture), SkylinePacker{page_size_}, 0}});
+	}
+
+	///Renderer pages are made for
+	SDL_Renderer* renderer_;
+	///Size of the pages
+	Vec2i page_size_;
+	///Format of the pages
+	Uint32 format_;
+	///Empty pixels kept on the right and bottom of each image
+	int padding_;
+
+	///Pages, behind pointers so that regions stay valid when pages are added
+	std::vector<std::unique_ptr<Page>> pages_;
+	///Images, indexed by id
+	std::vector<Entry> entries_;
+	///Ids of erased images, to reuse
+	std::vector<Id> free_ids_;
+};
+
+} // namespace sdl
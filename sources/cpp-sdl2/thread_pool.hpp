@@ -0,0 +1,211 @@
+#pragma once
+
+#include "system.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sdl
+{
+namespace details
+{
+///Number of rows worth giving to one thread, so that a chunk is at least ~64KiB of pixels
+inline int min_rows_per_chunk(int row_bytes)
+{
+	return std::max(1, (64 * 1024) / std::max(row_bytes, 1));
+}
+} // namespace details
+
+///\brief Fixed set of worker threads used to split data-parallel work (rows of pixels, mostly).
+///
+///The thread calling parallel_for() takes part in the work, and blocks until every chunk is done.
+///Calls made from inside a chunk run inline, so nesting parallel_for() is safe.
+class ThreadPool
+{
+public:
+	///Create a pool able to run `threads` chunks at once, including the calling thread
+	explicit ThreadPool(int threads = system::cpu_count())
+	{
+		for (int i = 1; i < threads; ++i) workers_.emplace_back([this] { work(); });
+	}
+
+	///Stop and join all workers
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (auto& worker : workers_) worker.join();
+	}
+
+	///This object owns threads, it is not copyable
+	ThreadPool(ThreadPool const&) = delete;
+	///This object owns threads, it is not copyable
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	///Number of chunks that can run at once
+	int size() const { return int(workers_.size()) + 1; }
+
+	///Pool shared by the whole process, sized from sdl::system::cpu_count()
+	static ThreadPool& shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	///\brief Call `f(chunk_begin, chunk_end)` over sub-ranges of [begin, end), in parallel.
+	///
+	///\param min_chunk smallest sub-range worth handing to another thread
+	///Exceptions thrown from f are rethrown in the calling thread once all chunks are done.
+	template<typename F>
+	void parallel_for(int begin, int end, F&& f, int min_chunk = 1)
+	{
+		const int count  = end - begin;
+		const int chunks = std::min(size() * 4, count / std::max(min_chunk, 1));
+
+		if (count <= 0) return;
+		if (chunks <= 1 || workers_.empty() || in_worker())
+		{
+			f(begin, end);
+			return;
+		}
+
+		using Func = std::remove_reference_t<F>;
+
+		Job job;
+		job.call	  = [](void* ctx, int b, int e) { (*static_cast<Func*>(ctx))(b, e); };
+		job.ctx		  = const_cast<void*>(static_cast<void const*>(std::addressof(f)));
+		job.begin	  = begin;
+		job.count	  = count;
+		job.chunks	  = chunks;
+		job.remaining = chunks;
+
+		// Only one job can be in flight. Callers on other threads queue up here.
+		std::lock_guard<std::mutex> serial{submit_};
+
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			job_ = &job;
+			++generation_;
+		}
+		wake_.notify_all();
+
+		in_worker() = true;
+		run(job);
+		in_worker() = false;
+
+		{
+			std::unique_lock<std::mutex> lock{mutex_};
+			done_.wait(lock, [&] { return job.remaining == 0 && job.active == 0; });
+			job_ = nullptr;
+		}
+
+#ifndef CPP_SDL2_DISABLE_EXCEPTIONS
+		if (job.error) std::rethrow_exception(job.error);
+#endif
+	}
+
+private:
+	///Work item shared by all threads during a parallel_for() call
+	struct Job
+	{
+		void (*call)(void*, int, int) = nullptr;
+		void*			   ctx		  = nullptr;
+		int				   begin	  = 0;
+		int				   count	  = 0;
+		int				   chunks	  = 0;
+		std::atomic<int>   next{0};
+		int				   remaining = 0;
+		int				   active	 = 0;
+		std::exception_ptr error;
+	};
+
+	///True on the pool threads, and on a thread currently running a job
+	static bool& in_worker()
+	{
+		thread_local bool flag = false;
+		return flag;
+	}
+
+	///Run chunks of the job until there are none left
+	void run(Job& job)
+	{
+		for (int i; (i = job.next.fetch_add(1)) < job.chunks;)
+		{
+			const int b = job.begin + int(std::int64_t(job.count) * i / job.chunks);
+			const int e = job.begin + int(std::int64_t(job.count) * (i + 1) / job.chunks);
+
+#ifndef CPP_SDL2_DISABLE_EXCEPTIONS
+			try
+			{
+				job.call(job.ctx, b, e);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock{mutex_};
+				if (!job.error) job.error = std::current_exception();
+			}
+#else
+			job.call(job.ctx, b, e);
+#endif
+
+			std::lock_guard<std::mutex> lock{mutex_};
+			if (--job.remaining == 0) done_.notify_all();
+		}
+	}
+
+	///Worker thread main loop
+	void work()
+	{
+		in_worker() = true;
+
+		for (unsigned long long seen = 0;;)
+		{
+			Job* job = nullptr;
+			{
+				std::unique_lock<std::mutex> lock{mutex_};
+				wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+				if (stop_) return;
+
+				seen = generation_;
+				job	 = job_;
+				if (!job) continue;
+				++job->active;
+			}
+
+			run(*job);
+
+			std::lock_guard<std::mutex> lock{mutex_};
+			if (--job->active == 0) done_.notify_all();
+		}
+	}
+
+	///Worker threads
+	std::vector<std::thread> workers_;
+	///Serialize parallel_for() calls
+	std::mutex submit_;
+	///Protect everything below
+	std::mutex mutex_;
+	///Signaled when a job is posted, or when the pool stops
+	std::condition_variable wake_;
+	///Signaled when a job may be done
+	std::condition_variable done_;
+	///Job currently running, if any
+	Job* job_ = nullptr;
+	///Incremented each time a job is posted
+	unsigned long long generation_ = 0;
+	///Set when the pool is being destroyed
+	bool stop_ = false;
+};
+
+} // namespace sdl
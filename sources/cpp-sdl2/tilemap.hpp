@@ -0,0 +1,364 @@
+#pragma once
+
+#include "color.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "render_batch.hpp"
+#include "render_target.hpp"
+#include "renderer.hpp"
+#include "texture.hpp"
+#include "vec2.hpp"
+
+#include <SDL_events.h>
+#include <SDL_render.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace sdl
+{
+///\brief Grid of tiles drawn from cached chunk textures, so that drawing a frame costs one copy
+///per visible chunk instead of one per visible tile.
+///
+///The map is split in square chunks of chunk_tiles x chunk_tiles tiles. The first time a chunk is
+///visible, its tiles are drawn to a target texture of its own, which is then copied to the screen
+///on every frame. Changing a tile only marks its chunk to be drawn again on its next use. Chunks
+///outside of the camera are skipped without being looked at, and the textures of the chunks that
+///were not visible for the longest time are freed when more than max_cached_chunks are kept.
+///
+///Tiles are numbers: no_tile is empty, and tile n is the (n - 1)th tile of the tileset texture,
+///counting from left to right and top to bottom. Chunks are composited with a premultiplied blend
+///mode, so translucent tiles look as if drawn directly; where the renderer doesn't support it (see
+///Layer), only their opaque pixels do.
+class Tilemap
+{
+public:
+	///Index of a tile in the tileset, starting at 1
+	using Tile = Uint16;
+	///Empty tile
+	static constexpr Tile no_tile = 0;
+
+	///Create a map filled with no_tile. The renderer and the tileset must outlive the map
+	///\param tile_size size of a tile, in the tileset and on the screen at scale 1
+	///\param size size of the map, in tiles
+	///\param chunk_tiles width and height of a chunk, in tiles
+	///\param max_cached_chunks number of chunk textures kept before freeing those not visible
+	Tilemap(
+		Renderer const& renderer,
+		Texture const&	tileset,
+		Vec2i			tile_size,
+		Vec2i			size,
+		int				chunk_tiles		  = 32,
+		size_t			max_cached_chunks = 256)
+		: renderer_{&renderer}
+		, tile_size_{tile_size}
+		, size_{std::max(size.x, 0), std::max(size.y, 0)}
+		, chunk_tiles_{chunk_tiles}
+		, max_cached_{max_cached_chunks}
+	{
+		if (tile_size.x <= 0 || tile_size.y <= 0 || chunk_tiles <= 0)
+		{
+			SDL_SetError(
+				"Invalid tile size %dx%d or chunk size %d", tile_size.x, tile_size.y, chunk_tiles);
+			throw Exception{"Tilemap"};
+		}
+
+		set_tileset(tileset);
+		grid_ = {(size_.x + chunk_tiles_ - 1) / chunk_tiles_,
+				 (size_.y + chunk_tiles_ - 1) / chunk_tiles_};
+		tiles_.resize(size_t(size_.x) * size_t(size_.y), no_tile);
+		chunks_.resize(size_t(grid_.x) * size_t(grid_.y));
+	}
+
+	///Get the size of the map, in tiles
+	Vec2i size() const { return size_; }
+	///Get the size of a tile
+	Vec2i tile_size() const { return tile_size_; }
+	///Get the size of the map, in pixels at scale 1
+	Vec2i pixel_size() const { return {size_.x * tile_size_.x, size_.y * tile_size_.y}; }
+
+	///Get a tile. Tiles outside of the map are no_tile
+	Tile tile(int x, int y) const
+	{
+		if (x < 0 || y < 0 || x >= size_.x || y >= size_.y) return no_tile;
+		return tiles_[size_t(y) * size_t(size_.x) + size_t(x)];
+	}
+
+	///Get a tile. Tiles outside of the map are no_tile
+	Tile tile(Vec2i const& pos) const { return tile(pos.x, pos.y); }
+
+	///Change a tile. Its chunk is drawn again on its next use if the tile changed
+	void set_tile(int x, int y, Tile t)
+	{
+		if (x < 0 || y < 0 || x >= size_.x || y >= size_.y)
+		{
+			SDL_SetError("Tile %d,%d is outside of a %dx%d map", x, y, size_.x, size_.y);
+			throw Exception{"Tilemap::set_tile"};
+		}
+
+		auto& current = tiles_[size_t(y) * size_t(size_.x) + size_t(x)];
+		if (current == t) return;
+		current = t;
+		chunk_at(x / chunk_tiles_, y / chunk_tiles_).dirty = true;
+	}
+
+	///Change a tile. Its chunk is drawn again on its next use if the tile changed
+	void set_tile(Vec2i const& pos, Tile t) { set_tile(pos.x, pos.y, t); }
+
+	///Set every tile of an area, in tiles. The area is clipped to the map
+	void fill(Rect const& area, Tile t)
+	{
+		const auto r = area.inter(Rect{0, 0, size_.x, size_.y});
+		if (r.is_empty()) return;
+
+		for (int y = r.y1(); y < r.y2(); ++y)
+		{
+			auto row = tiles_.begin() + std::ptrdiff_t(y) * size_.x;
+			std::fill(row + r.x1(), row + r.x2(), t);
+		}
+		for (int cy = r.y1() / chunk_tiles_; cy <= (r.y2() - 1) / chunk_tiles_; ++cy)
+			for (int cx = r.x1() / chunk_tiles_; cx <= (r.x2() - 1) / chunk_tiles_; ++cx)
+				chunk_at(cx, cy).dirty = true;
+	}
+
+	///Use another tileset texture, e.g. after it was created again. Every chunk is drawn again
+	void set_tileset(Texture const& tileset)
+	{
+		const auto columns = tileset.size().x / tile_size_.x;
+		if (columns <= 0)
+		{
+			SDL_SetError(
+				"Tileset of width %d is smaller than a tile of width %d",
+				tileset.size().x,
+				tile_size_.x);
+			throw Exception{"Tilemap::set_tileset"};
+		}
+
+		tileset_		 = &tileset;
+		tileset_columns_ = columns;
+		invalidate();
+	}
+
+	///Mark every chunk to be drawn again on its next use
+	void invalidate()
+	{
+		for (auto& c : chunks_) c.dirty = true;
+	}
+
+	///Free every chunk texture. They are made again when needed
+	void trim()
+	{
+		for (auto i : cached_) chunks_[i].texture = Texture{};
+		cached_.clear();
+	}
+
+	///\brief Update the chunks on renderer events. Return true if the event concerned them.
+	///
+	///When the renderer lost the content of its target textures, chunks are drawn again. After a
+	///device reset, they are made again; call set_tileset() with the new tileset as well.
+	bool handle(SDL_Event const& event)
+	{
+		switch (event.type)
+		{
+		case SDL_RENDER_TARGETS_RESET: invalidate(); return true;
+		case SDL_RENDER_DEVICE_RESET: trim(); return true;
+		default: return false;
+		}
+	}
+
+	///\brief Draw the part of the map seen by a camera to an area of the current render target.
+	///
+	///Nothing is drawn outside of the viewport.
+	///\param camera area of the map to draw, in pixels at scale 1
+	///\param viewport where to draw it. The map is scaled if the sizes differ
+	void render(Rect const& camera, Rect const& viewport)
+	{
+		++frame_;
+		drawn_	 = 0;
+		redrawn_ = 0;
+
+		const auto view = camera.inter(Rect{{0, 0}, pixel_size()});
+		if (camera.is_empty() || viewport.is_empty() || view.is_empty()) return;
+
+		// Chunks overlapping the camera, found directly from its position
+		const auto chunk_w = chunk_tiles_ * tile_size_.x, chunk_h = chunk_tiles_ * tile_size_.y;
+		const int  cx0 = view.x1() / chunk_w, cx1 = (view.x2() - 1) / chunk_w;
+		const int  cy0 = view.y1() / chunk_h, cy1 = (view.y2() - 1) / chunk_h;
+
+		// Update every chunk first, switching targets from chunk to chunk, so that the target
+		// drawn to goes back only once
+		{
+			ScopedRenderTarget target{*renderer_};
+			for (int cy = cy0; cy <= cy1; ++cy)
+				for (int cx = cx0; cx <= cx1; ++cx) update(cx, cy);
+		}
+
+		for (int cy = cy0; cy <= cy1; ++cy)
+		{
+			for (int cx = cx0; cx <= cx1; ++cx)
+			{
+				const auto b	= chunk_bounds(cx, cy);
+				const auto part = b.inter(view);
+
+				// Copy only the part of the chunk seen by the camera, and map its edges, so that
+				// neighbours stay joined when scaled
+				const auto x1 = to_viewport(part.x1(), camera.x, camera.w, viewport.x, viewport.w);
+				const auto x2 = to_viewport(part.x2(), camera.x, camera.w, viewport.x, viewport.w);
+				const auto y1 = to_viewport(part.y1(), camera.y, camera.h, viewport.y, viewport.h);
+				const auto y2 = to_viewport(part.y2(), camera.y, camera.h, viewport.y, viewport.h);
+				renderer_->render_copy(
+					chunk_at(cx, cy).texture,
+					Rect{part.x - b.x, part.y - b.y, part.w, part.h},
+					Rect{x1, y1, x2 - x1, y2 - y1});
+				++drawn_;
+			}
+		}
+
+		evict();
+	}
+
+	///Draw the part of the map seen by a camera, at scale 1, to the top left of the render target
+	void render(Rect const& camera) { render(camera, Rect{{0, 0}, camera.size()}); }
+
+	///Get the number of chunks copied by the last render()
+	size_t chunks_drawn() const { return drawn_; }
+	///Get the number of chunks whose tiles were drawn again by the last render()
+	size_t chunks_redrawn() const { return redrawn_; }
+	///Get the number of chunk textures kept
+	size_t cached_chunks() const { return cached_.size(); }
+
+private:
+	///A square of tiles, drawn to a texture
+	struct Chunk
+	{
+		///Tiles drawn, or empty if the chunk isn't cached
+		Texture texture;
+		///True if the texture doesn't show the current tiles
+		bool dirty = true;
+		///Number of the last frame the chunk was visible in
+		Uint64 last_used = 0;
+	};
+
+	///Get a chunk from its position in the chunk grid
+	Chunk& chunk_at(int cx, int cy) { return chunks_[size_t(cy) * size_t(grid_.x) + size_t(cx)]; }
+
+	///Get the area covered by a chunk, in pixels. Chunks on the right and bottom edges may be
+	///smaller than the others
+	Rect chunk_bounds(int cx, int cy) const
+	{
+		const auto tx = cx * chunk_tiles_, ty = cy * chunk_tiles_;
+		const auto tw = std::min(chunk_tiles_, size_.x - tx);
+		const auto th = std::min(chunk_tiles_, size_.y - ty);
+		return Rect{tx * tile_size_.x, ty * tile_size_.y, tw * tile_size_.x, th * tile_size_.y};
+	}
+
+	///Map a coordinate of the map to the viewport
+	static int to_viewport(int v, int camera_pos, int camera_size, int view_pos, int view_size)
+	{
+		return view_pos + int((long long)(v - camera_pos) * view_size / camera_size);
+	}
+
+	///Make sure a visible chunk has a texture showing its tiles. The render target is left on its
+	///texture if it was drawn
+	void update(int cx, int cy)
+	{
+		auto& c		= chunk_at(cx, cy);
+		c.last_used = frame_;
+
+		if (!c.texture.ptr())
+		{
+			const auto b = chunk_bounds(cx, cy);
+			c.texture	 = Texture{
+				   renderer_->ptr(), SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, b.size()};
+			details::set_premultiplied_blendmode(c.texture);
+			cached_.push_back(size_t(cy) * size_t(grid_.x) + size_t(cx));
+			c.dirty = true;
+		}
+		if (!c.dirty) return;
+
+		renderer_->set_target(c.texture);
+		renderer_->clear(Color::Transparent());
+
+		// All tiles come from the same texture: the batch sends them in one go
+		// The batch starts with the draw color clear() left: make it opaque white, so that nothing
+		// it draws comes out transparent
+		RenderBatch batch{*renderer_};
+		batch.set_drawcolor(Color::White());
+		const auto	tx = cx * chunk_tiles_, ty = cy * chunk_tiles_;
+		const auto	tw = std::min(chunk_tiles_, size_.x - tx);
+		const auto	th = std::min(chunk_tiles_, size_.y - ty);
+		for (int y = 0; y < th; ++y)
+		{
+			auto row = tiles_.data() + size_t(ty + y) * size_t(size_.x) + size_t(tx);
+			for (int x = 0; x < tw; ++x)
+			{
+				if (row[x] == no_tile) continue;
+
+				const auto i   = int(row[x]) - 1;
+				const auto src = Rect{
+					i % tileset_columns_ * tile_size_.x,
+					i / tileset_columns_ * tile_size_.y,
+					tile_size_.x,
+					tile_size_.y};
+				batch.render_copy(
+					*tileset_,
+					src,
+					Rect{x * tile_size_.x, y * tile_size_.y, tile_size_.x, tile_size_.y});
+			}
+		}
+		batch.flush();
+
+		c.dirty = false;
+		++redrawn_;
+	}
+
+	///Free the textures of the chunks not visible for the longest time, down to max_cached_
+	void evict()
+	{
+		if (cached_.size() <= max_cached_) return;
+
+		std::sort(cached_.begin(), cached_.end(), [&](size_t a, size_t b) {
+			return chunks_[a].last_used < chunks_[b].last_used;
+		});
+
+		// Chunks visible in this frame are kept, even over the limit
+		size_t n = 0;
+		while (cached_.size() - n > max_cached_ && chunks_[cached_[n]].last_used < frame_)
+			chunks_[cached_[n++]].texture = Texture{};
+		cached_.erase(cached_.begin(), cached_.begin() + std::ptrdiff_t(n));
+	}
+
+	///Renderer the chunks are made for
+	Renderer const* renderer_;
+	///Texture holding the tiles
+	Texture const* tileset_ = nullptr;
+	///Number of tiles in a row of the tileset
+	int tileset_columns_ = 0;
+	///Size of a tile, in pixels
+	Vec2i tile_size_;
+	///Size of the map, in tiles
+	Vec2i size_;
+	///Width and height of a chunk, in tiles
+	int chunk_tiles_;
+	///Size of the map, in chunks
+	Vec2i grid_;
+
+	///Tiles, row after row
+	std::vector<Tile> tiles_;
+	///Chunks, row after row
+	std::vector<Chunk> chunks_;
+	///Indices of the chunks that have a texture
+	std::vector<size_t> cached_;
+	///Number of chunk textures kept before freeing some
+	size_t max_cached_;
+
+	///Number of render() calls so far
+	Uint64 frame_ = 0;
+	///Chunks copied by the last render()
+	size_t drawn_ = 0;
+	///Chunks drawn again by the last render()
+	size_t redrawn_ = 0;
+};
+
+} // namespace sdl
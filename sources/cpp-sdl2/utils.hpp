@@ -3,6 +3,7 @@
 #include <SDL.h>
 #include <string>
 
+#include "system.hpp"
 #include "window.hpp"
 
 namespace sdl
@@ -32,115 +33,6 @@ inline void show_message_box(
 	SDL_ShowSimpleMessageBox(flags, title.c_str(), message.c_str(), parent.ptr());
 }
 
-///Get information about the system (os, cpu, ram...)
-namespace system
-{
-// new in 2.0.9
-#if SDL_VERSION_ATLEAST(2, 0, 9)
-inline bool is_tablet()
-{
-	return SDL_IsTablet();
-}
-
-inline bool has_AVX512F()
-{
-	return SDL_HasAVX512F();
-}
-#endif
-
-///Get used platform as a string
-inline std::string platform()
-{
-	return SDL_GetPlatform();
-}
-
-///Get the size of a cacheline
-/// \return size of "L1" cache, in bytes
-inline int cpu_cacheline_size()
-{
-	return SDL_GetCPUCacheLineSize();
-}
-
-///Get the numbers of CPU in the system
-inline int cpu_count()
-{
-	return SDL_GetCPUCount();
-}
-
-///Get the amount of ram in the system
-///`\return amount of RAM in MB
-inline int system_ram()
-{
-	return SDL_GetSystemRAM();
-}
-
-///Returns true if system has AMD 3DNow! support
-inline bool has_3DNow()
-{
-	return SDL_Has3DNow();
-}
-
-///Return true if CPU has AVX instruction set support
-inline bool has_AVX()
-{
-	return SDL_HasAVX();
-}
-
-///Return true if CPU has AVX2 instruction set support
-inline bool has_AVX2()
-{
-	return SDL_HasAVX2();
-}
-
-///Return true if cpu has Apple/IBM/Motorola AltiVec SIMD support
-inline bool has_AltiVec()
-{
-	return SDL_HasAltiVec();
-}
-
-///Return true if cpu has Intel MMX support
-inline bool has_MMX()
-{
-	return SDL_HasMMX();
-}
-
-///Return true if current cpu has a TSC register
-inline bool has_RDTSC()
-{
-	return SDL_HasRDTSC();
-}
-
-///Return true if cpu supports 1st gen SSE
-inline bool has_SSE()
-{
-	return SDL_HasSSE();
-}
-
-///Return true if cpu supports SSE2
-inline bool has_SSE2()
-{
-	return has_SSE2();
-}
-
-///Return true if cpu supports SSE3
-inline bool has_SSE3()
-{
-	return has_SSE3();
-}
-
-///Return true if cpu supports SSE41
-inline bool has_SSE41()
-{
-	return has_SSE41();
-}
-
-///Return true if cpu supports SSE42
-inline bool has_SSE42()
-{
-	return has_SSE42();
-}
-} // namespace system
-
 ///Power related functions
 namespace power
 {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <SDL_rect.h>
+#include <SDL_version.h>
 #include <algorithm>
 #include <cmath>
 #include <ostream>
@@ -158,8 +159,13 @@ private:
 
 ///Vector of two integers, that is convertible to/from SDL_Point
 using Vec2i = Vec2<int, SDL_Point>;
+#if SDL_VERSION_ATLEAST(2, 0, 10)
+///Vector of two floats, that is convertible to/from SDL_FPoint
+using Vec2f = Vec2<float, SDL_FPoint>;
+#else
 ///Vector of two floats
 using Vec2f = Vec2<float>;
+#endif
 ///Vector of two double
 using Vec2d = Vec2<double>;
 
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "bounded_queue.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "renderer.hpp"
+#include "surface.hpp"
+#include "yuv_convert.hpp"
+
+#include <SDL_rwops.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sdl
+{
+///\brief Writes I420 images as the frames of a YUV4MPEG2 (.y4m) file.
+///
+///Y4M is raw video with a small text header, read by ffmpeg, x264 and most encoders (also from a
+///pipe). The size of the video is the size of the first frame. Copies of a writer write to the
+///same file, which is closed when the last copy is destroyed.
+class Y4mWriter
+{
+public:
+	///Create or truncate a file
+	///\param fps_num, fps_den frame rate, as a fraction
+	explicit Y4mWriter(std::string const& filename, int fps_num = 60, int fps_den = 1)
+		: state_{std::make_shared<State>()}
+	{
+		state_->file = SDL_RWFromFile(filename.c_str(), "wb");
+		if (!state_->file) throw Exception{"SDL_RWFromFile"};
+		state_->fps_num = fps_num;
+		state_->fps_den = fps_den;
+	}
+
+	///Append a frame. Throws if its size isn't the size of the video
+	void write(I420Image const& frame)
+	{
+		auto& s = *state_;
+		if (s.frames == 0)
+		{
+			s.size	 = frame.size();
+			auto len = SDL_snprintf(
+				s.line,
+				sizeof s.line,
+				"YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg XCOLORRANGE=LIMITED\n",
+				s.size.x,
+				s.size.y,
+				s.fps_num,
+				s.fps_den);
+			put(s.line, size_t(len));
+		}
+		else if (frame.size() != s.size)
+		{
+			SDL_SetError(
+				"Frame of %dx%d in a %dx%d video",
+				frame.width(),
+				frame.height(),
+				s.size.x,
+				s.size.y);
+			throw Exception{"Y4mWriter::write"};
+		}
+
+		put("FRAME\n", 6);
+		put(frame.data(), frame.bytes());
+		++s.frames;
+	}
+
+	///Append a frame, to use a writer as a VideoRecorder::FrameSink
+	void operator()(I420Image const& frame) { write(frame); }
+
+	///Get the number of frames written
+	size_t frames() const { return state_->frames; }
+
+private:
+	///File shared by the copies of a writer
+	struct State
+	{
+		SDL_RWops* file = nullptr;
+		int		   fps_num;
+		int		   fps_den;
+		Vec2i	   size;
+		size_t	   frames = 0;
+		///Formatted header
+		char line[128];
+
+		~State()
+		{
+			if (file) SDL_RWclose(file);
+		}
+	};
+
+	///Write bytes to the file
+	void put(void const* data, size_t size)
+	{
+		if (SDL_RWwrite(state_->file, data, 1, size) != size) throw Exception{"SDL_RWwrite"};
+	}
+
+	std::shared_ptr<State> state_;
+};
+
+///\brief Records frames of a renderer or surfaces as I420, and feeds them to a sink on a
+///background thread.
+///
+///Frames are converted to I420 on the calling thread with SIMD code, so that each queued frame
+///takes 1.5 bytes per pixel instead of 4. They are then handed to the sink (e.g. a Y4mWriter, or a
+///pipe to an encoder) by a thread owned by the recorder. At most max_pending frames are queued:
+///record() waits for room, so that nothing is lost, while try_record() drops the frame instead.
+///Frame buffers are recycled, so a long recording doesn't allocate.
+class VideoRecorder
+{
+public:
+	///Function receiving each frame, on the writer thread. Throws on failure
+	using FrameSink = std::function<void(I420Image const&)>;
+
+	///Start the writer thread
+	///\param max_pending number of frames queued before record() waits
+	explicit VideoRecorder(FrameSink sink, size_t max_pending = 8)
+		: sink_{std::move(sink)}, queue_{max_pending}, thread_{[this] { work(); }}
+	{
+	}
+
+	///Write the frames still queued, and stop the writer thread
+	~VideoRecorder()
+	{
+		queue_.close();
+		thread_.join();
+	}
+
+	///This object owns a thread, it is not copyable
+	VideoRecorder(VideoRecorder const&) = delete;
+	///This object owns a thread, it is not copyable
+	VideoRecorder& operator=(VideoRecorder const&) = delete;
+
+	///Record a surface, waiting if the writer is max_pending frames behind
+	void record(Surface const& frame)
+	{
+		auto image = take_image();
+		image.assign(frame);
+		queue(std::move(image), true);
+	}
+
+	///Record a surface, unless the writer is max_pending frames behind. Return false if the frame
+	///was dropped
+	bool try_record(Surface const& frame)
+	{
+		if (full()) return drop();
+
+		auto image = take_image();
+		image.assign(frame);
+		return queue(std::move(image), false);
+	}
+
+	///Record the whole current render target, waiting if the writer is max_pending frames behind.
+	///Call it after drawing and before Renderer::present()
+	void record(Renderer const& renderer) { record(read(renderer)); }
+
+	///Record the whole current render target, unless the writer is max_pending frames behind.
+	///Return false if the frame was dropped
+	bool try_record(Renderer const& renderer)
+	{
+		if (full()) return drop();
+		return try_record(read(renderer));
+	}
+
+	///Wait until every queued frame is handed to the sink
+	void flush()
+	{
+		std::unique_lock<std::mutex> lock{mutex_};
+		idle_.wait(lock, [this] { return pending_ == 0; });
+	}
+
+	///Get the number of frames handed to the sink
+	size_t recorded() const { return recorded_; }
+	///Get the number of frames dropped by try_record()
+	size_t dropped() const { return dropped_; }
+	///Get the number of frames the sink failed to handle
+	size_t failed() const { return failed_; }
+
+private:
+	///Return true if no frame can be queued without waiting
+	bool full() const { return queue_.size() >= queue_.capacity(); }
+
+	///Count a dropped frame, and return false
+	bool drop()
+	{
+		++dropped_;
+		return false;
+	}
+
+	///Read the render target into the staging surface
+	Surface const& read(Renderer const& renderer)
+	{
+		const auto size = renderer.output_size();
+		if (!staging_.ptr() || staging_.size() != size)
+			staging_ = Surface{0, size.x, size.y, 32, SDL_PIXELFORMAT_ARGB8888};
+		renderer.read_pixels(Rect{0, 0, size.x, size.y}, staging_);
+		return staging_;
+	}
+
+	///Get an unused image, recycled if possible
+	I420Image take_image()
+	{
+		std::lock_guard<std::mutex> lock{mutex_};
+		if (free_.empty()) return {};
+		auto image = std::move(free_.back());
+		free_.pop_back();
+		return image;
+	}
+
+	///Queue a converted frame, waiting for room or not
+	bool queue(I420Image&& image, bool wait)
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			++pending_;
+		}
+		if (wait ? queue_.push(std::move(image)) : queue_.try_push(std::move(image))) return true;
+
+		done(std::move(image));
+		return drop();
+	}
+
+	///Writer thread: hand frames to the sink until the queue is closed and empty
+	void work()
+	{
+		I420Image image;
+		while (queue_.pop(image))
+		{
+#ifndef CPP_SDL2_DISABLE_EXCEPTIONS
+			try
+			{
+				sink_(image);
+				++recorded_;
+			}
+			catch (Exception const&)
+			{
+				++failed_;
+			}
+#else
+			sink_(image);
+			++recorded_;
+#endif
+			done(std::move(image));
+		}
+	}
+
+	///Keep the buffer of a handled frame for reuse, and mark the frame as handled
+	void done(I420Image&& image)
+	{
+		{
+			std::lock_guard<std::mutex> lock{mutex_};
+			if (free_.size() <= queue_.capacity()) free_.push_back(std::move(image));
+			--pending_;
+		}
+		idle_.notify_all();
+	}
+
+	///Receives the frames
+	FrameSink sink_;
+	///Frames waiting for the writer thread
+	BoundedQueue<I420Image> queue_;
+	///Surface the render target is read into
+	Surface staging_{nullptr};
+
+	///Protect free_ and pending_
+	std::mutex mutex_;
+	///Signaled when a frame is handled
+	std::condition_variable idle_;
+	///Buffers of handled frames
+	std::vector<I420Image> free_;
+	///Frames queued and not handled yet
+	size_t pending_ = 0;
+
+	///Frames handed to the sink
+	std::atomic<size_t> recorded_{0};
+	///Frames dropped by try_record()
+	std::atomic<size_t> dropped_{0};
+	///Frames the sink failed to handle
+	std::atomic<size_t> failed_{0};
+
+	///Writer thread, started last so that every other member is ready
+	std::thread thread_;
+};
+
+} // namespace sdl
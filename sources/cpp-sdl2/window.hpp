@@ -2,9 +2,13 @@
 
 #include <SDL.h>
 #include <SDL_syswm.h>
+#include <cstddef>
 #include <string>
+#include <vector>
 
+#include "rect.hpp"
 #include "renderer.hpp"
+#include "surface.hpp"
 #include "vec2.hpp"
 
 #ifdef CPP_SDL2_ENABLE_VULKAN
@@ -70,6 +74,43 @@ public:
 		return Renderer{render};
 	}
 
+	///Software renderer drawing to the window surface. It gets the new surface when the window
+	///is resized, and Renderer::present() shows what it drew
+	Renderer make_surface_renderer() const { return make_renderer(SDL_RENDERER_SOFTWARE); }
+
+	///\brief Get the surface of the window, to draw on it without a renderer.
+	///
+	///The surface belongs to the window, and the returned object doesn't own it. SDL frees it
+	///when the window is resized, on the next call to this function: the object must not be used
+	///after that, except to be destroyed or assigned to. It can't be used with a renderer of the
+	///same window.
+	Surface surface() const
+	{
+		const auto s = SDL_GetWindowSurface(window_);
+		if (!s) throw Exception{"SDL_GetWindowSurface"};
+		return Surface::non_owning(s);
+	}
+
+	///Show the whole window surface on screen
+	void update_surface() const
+	{
+		if (SDL_UpdateWindowSurface(window_) != 0) throw Exception{"SDL_UpdateWindowSurface"};
+	}
+
+	///Show count areas of the window surface on screen
+	void update_surface(Rect const* rects, size_t count) const
+	{
+		if (count == 0) return;
+		if (SDL_UpdateWindowSurfaceRects(window_, rects, int(count)) != 0)
+			throw Exception{"SDL_UpdateWindowSurfaceRects"};
+	}
+
+	///Show areas of the window surface on screen
+	void update_surface(std::vector<Rect> const& rects) const
+	{
+		update_surface(rects.data(), rects.size());
+	}
+
 	///Get the current window display index
 	int display_index() const
 	{
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "color.hpp"
+#include "dirty_region.hpp"
+#include "exception.hpp"
+#include "rect.hpp"
+#include "surface.hpp"
+#include "vec2.hpp"
+#include "window.hpp"
+
+#include <SDL_events.h>
+#include <SDL_video.h>
+
+#include <cstddef>
+
+namespace sdl
+{
+///\brief Window surface that only sends what changed to the screen.
+///
+///Areas drawn to the surface are recorded with mark_dirty(), and present() shows only them with
+///SDL_UpdateWindowSurfaceRects(). After the window is resized or exposed, the next present() shows
+///everything. Pass the window events to handle() to keep track of that.
+class WindowSurface
+{
+public:
+	///Track the surface of a window. The window must outlive this object
+	///\param max_rects number of dirty rects kept before merging them
+	explicit WindowSurface(Window const& window, size_t max_rects = 16)
+		: window_{&window}, surface_{window.surface()}, dirty_{bounds(), max_rects}
+	{
+		dirty_.add_all();
+	}
+
+	///Get the window surface, to draw on it. Call mark_dirty() on what you draw
+	Surface& surface() { return surface_; }
+	///Get the window surface
+	Surface const& surface() const { return surface_; }
+	///Get the window surface size
+	Vec2i size() const { return {surface_.width(), surface_.height()}; }
+
+	///Fill an area of the surface, and mark it dirty
+	void fill(Rect const& area, Color const& color)
+	{
+		surface_.fill(area, color);
+		dirty_.add(area);
+	}
+
+	///Fill the whole surface, and mark it dirty
+	void fill(Color const& color) { fill(bounds(), color); }
+
+	///Mark an area as changed, so that the next present() shows it
+	void mark_dirty(Rect const& area) { dirty_.add(area); }
+	///Mark the whole surface as changed
+	void invalidate() { dirty_.add_all(); }
+	///Get the areas changed since the last present()
+	DirtyRegion const& dirty() const { return dirty_; }
+
+	///\brief Update the tracking on window events. Return true if the event was for this window.
+	///
+	///When the window size changed, the surface is fetched again and its content is lost.
+	bool handle(SDL_Event const& event)
+	{
+		if (event.type != SDL_WINDOWEVENT) return false;
+		if (event.window.windowID != SDL_GetWindowID(window_->ptr())) return false;
+
+		switch (event.window.event)
+		{
+		case SDL_WINDOWEVENT_SIZE_CHANGED: refresh(); break;
+		case SDL_WINDOWEVENT_EXPOSED: invalidate(); break;
+		default: break;
+		}
+		return true;
+	}
+
+	///Fetch the window surface again, e.g. after the window was resized
+	void refresh()
+	{
+		surface_ = window_->surface();
+		dirty_.set_bounds(bounds());
+		dirty_.add_all();
+	}
+
+	///Show the dirty areas on screen, and clear them
+	void present()
+	{
+		if (dirty_.empty()) return;
+
+		if (dirty_.area() == (long long)surface_.width() * surface_.height())
+			window_->update_surface();
+		else
+			window_->update_surface(dirty_.rects());
+		dirty_.clear();
+	}
+
+private:
+	///Area covered by the surface
+	Rect bounds() const { return Rect{0, 0, surface_.width(), surface_.height()}; }
+
+	///Window the surface belongs to
+	Window const* window_;
+	///The window surface
+	Surface surface_;
+	///Areas not shown on screen yet
+	DirtyRegion dirty_;
+};
+
+} // namespace sdl
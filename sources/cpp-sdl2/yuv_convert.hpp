@@ -0,0 +1,475 @@
+#pragma once
+
+#include "exception.hpp"
+#include "pixel_convert.hpp"
+#include "surface.hpp"
+#include "system.hpp"
+#include "vec2.hpp"
+
+#include <SDL_pixels.h>
+#include <SDL_surface.h>
+
+#ifdef CPP_SDL2_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace sdl
+{
+namespace details
+{
+///\brief Weights of the BT.601 limited range RGB to YUV conversion, for each byte of two 4 byte
+///pixels.
+///
+///Y = (66 R + 129 G + 25 B) / 256 + 16, computed on single pixels. U and V are computed on the
+///sum of the four pixels of a 2x2 block: U = (-38 R - 74 G + 112 B) / 1024 + 128 and
+///V = (112 R - 94 G - 18 B) / 1024 + 128. Bytes that aren't a color channel weigh 0.
+struct YuvWeights
+{
+	alignas(16) std::array<Sint16, 8> y = {};
+	alignas(16) std::array<Sint16, 8> u = {};
+	alignas(16) std::array<Sint16, 8> v = {};
+};
+
+///Bias and rounding added to the weighted sum of one pixel, before dividing it by 256
+constexpr int yuv_luma_bias = (16 << 8) + 128;
+///Bias and rounding added to the weighted sum of a 2x2 block, before dividing it by 1024. It
+///keeps the sum positive
+constexpr int yuv_chroma_bias = (128 << 10) + 512;
+
+///Get the weights for pixels with the given byte layout, which must have 4 bytes per pixel
+inline YuvWeights make_yuv_weights(ByteLayout const& l)
+{
+	YuvWeights w;
+	for (int p = 0; p < 8; p += 4)
+	{
+		w.y[p + l.r] = 66;
+		w.y[p + l.g] = 129;
+		w.y[p + l.b] = 25;
+		w.u[p + l.r] = -38;
+		w.u[p + l.g] = -74;
+		w.u[p + l.b] = 112;
+		w.v[p + l.r] = 112;
+		w.v[p + l.g] = -94;
+		w.v[p + l.b] = -18;
+	}
+	return w;
+}
+
+///\brief Convert pixels [x, width) of two rows to I420, one 2x2 block at a time.
+///
+///x must be even. At the right edge of odd widths, the last column is counted twice. For the last
+///row of odd heights, pass the same row twice and a null y1.
+inline void i420_rows_scalar(
+	YuvWeights const& w,
+	Uint8 const*	  row0,
+	Uint8 const*	  row1,
+	Uint8*			  y0,
+	Uint8*			  y1,
+	Uint8*			  u,
+	Uint8*			  v,
+	int				  x,
+	int				  width)
+{
+	const auto luma = [&](Uint8 const* px) {
+		int sum = yuv_luma_bias;
+		for (int i = 0; i < 4; ++i) sum += w.y[i] * px[i];
+		return Uint8(sum >> 8);
+	};
+
+	for (; x < width; x += 2)
+	{
+		const auto right = x + 1 < width ? 4 : 0;
+		Uint8 const* block[4]
+			= {row0 + x * 4, row0 + x * 4 + right, row1 + x * 4, row1 + x * 4 + right};
+
+		y0[x] = luma(block[0]);
+		if (right) y0[x + 1] = luma(block[1]);
+		if (y1)
+		{
+			y1[x] = luma(block[2]);
+			if (right) y1[x + 1] = luma(block[3]);
+		}
+
+		int su = yuv_chroma_bias, sv = yuv_chroma_bias;
+		for (auto px : block)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				su += w.u[i] * px[i];
+				sv += w.v[i] * px[i];
+			}
+		}
+		u[x / 2] = Uint8(su >> 10);
+		v[x / 2] = Uint8(sv >> 10);
+	}
+}
+
+#ifdef CPP_SDL2_X86_DISPATCH
+///Get Y of 4 pixels, from their bytes widened to 16 bits, two pixels per register
+CPP_SDL2_TARGET("sse4.1")
+inline __m128i i420_luma_sse41(__m128i lo, __m128i hi, __m128i weights)
+{
+	const auto sum = _mm_hadd_epi32(_mm_madd_epi16(lo, weights), _mm_madd_epi16(hi, weights));
+	return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(yuv_luma_bias)), 8);
+}
+
+///Get U or V of 4 blocks, from the channel sums of two blocks per register
+CPP_SDL2_TARGET("sse4.1")
+inline __m128i i420_chroma_sse41(__m128i blocks01, __m128i blocks23, __m128i weights)
+{
+	const auto sum = _mm_hadd_epi32(
+		_mm_madd_epi16(blocks01, weights), _mm_madd_epi16(blocks23, weights));
+	return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(yuv_chroma_bias)), 10);
+}
+
+///Convert the start of two rows to I420, 16 pixels at a time. Return the number of pixels
+///converted
+CPP_SDL2_TARGET("sse4.1")
+inline int i420_rows_sse41(
+	YuvWeights const& w,
+	Uint8 const*	  row0,
+	Uint8 const*	  row1,
+	Uint8*			  y0,
+	Uint8*			  y1,
+	Uint8*			  u,
+	Uint8*			  v,
+	int				  width)
+{
+	const auto wy	= _mm_load_si128(reinterpret_cast<__m128i const*>(w.y.data()));
+	const auto wu	= _mm_load_si128(reinterpret_cast<__m128i const*>(w.u.data()));
+	const auto wv	= _mm_load_si128(reinterpret_cast<__m128i const*>(w.v.data()));
+	const auto zero = _mm_setzero_si128();
+
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i luma0[4], luma1[4], blocks[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			const auto offset = (x + i * 4) * 4;
+			const auto p0 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row0 + offset));
+			const auto p1 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row1 + offset));
+
+			// Two pixels per register, one channel per 16 bit lane
+			const auto lo0 = _mm_unpacklo_epi8(p0, zero), hi0 = _mm_unpackhi_epi8(p0, zero);
+			const auto lo1 = _mm_unpacklo_epi8(p1, zero), hi1 = _mm_unpackhi_epi8(p1, zero);
+			luma0[i] = i420_luma_sse41(lo0, hi0, wy);
+			luma1[i] = i420_luma_sse41(lo1, hi1, wy);
+
+			// Add the rows, then the pixels of each column pair: channel sums of 2 blocks
+			const auto lo = _mm_add_epi16(lo0, lo1), hi = _mm_add_epi16(hi0, hi1);
+			blocks[i] = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+		}
+
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(y0 + x),
+			_mm_packus_epi16(
+				_mm_packs_epi32(luma0[0], luma0[1]), _mm_packs_epi32(luma0[2], luma0[3])));
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(y1 + x),
+			_mm_packus_epi16(
+				_mm_packs_epi32(luma1[0], luma1[1]), _mm_packs_epi32(luma1[2], luma1[3])));
+
+		const auto cu = _mm_packs_epi32(
+			i420_chroma_sse41(blocks[0], blocks[1], wu),
+			i420_chroma_sse41(blocks[2], blocks[3], wu));
+		const auto cv = _mm_packs_epi32(
+			i420_chroma_sse41(blocks[0], blocks[1], wv),
+			i420_chroma_sse41(blocks[2], blocks[3], wv));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), _mm_packus_epi16(cu, cu));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_packus_epi16(cv, cv));
+	}
+	return x;
+}
+
+///Get Y of 8 pixels, from their bytes widened to 16 bits, two pixels per 128 bit lane
+CPP_SDL2_TARGET("avx2")
+inline __m256i i420_luma_avx2(__m256i lo, __m256i hi, __m256i weights)
+{
+	const auto sum
+		= _mm256_hadd_epi32(_mm256_madd_epi16(lo, weights), _mm256_madd_epi16(hi, weights));
+	return _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(yuv_luma_bias)), 8);
+}
+
+///Get U or V of 8 blocks, in order, from the channel sums of two blocks per 128 bit lane
+CPP_SDL2_TARGET("avx2")
+inline __m256i i420_chroma_avx2(__m256i blocks0123, __m256i blocks4567, __m256i weights)
+{
+	// hadd works within lanes, and gives blocks 0 1 4 5 2 3 6 7
+	const auto sum = _mm256_hadd_epi32(
+		_mm256_madd_epi16(blocks0123, weights), _mm256_madd_epi16(blocks4567, weights));
+	const auto ordered
+		= _mm256_permutevar8x32_epi32(sum, _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7));
+	return _mm256_srai_epi32(_mm256_add_epi32(ordered, _mm256_set1_epi32(yuv_chroma_bias)), 10);
+}
+
+///Pack 4 registers of 8 ints to 32 bytes, in order
+CPP_SDL2_TARGET("avx2")
+inline __m256i i420_pack_avx2(__m256i a, __m256i b, __m256i c, __m256i d)
+{
+	// Packing works within lanes: put the 64 bit quarters back in order after each step
+	const auto ab = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+	const auto cd = _mm256_permute4x64_epi64(_mm256_packs_epi32(c, d), 0xD8);
+	return _mm256_permute4x64_epi64(_mm256_packus_epi16(ab, cd), 0xD8);
+}
+
+///Pack 2 registers of 8 ints to 16 bytes, in order
+CPP_SDL2_TARGET("avx2")
+inline __m128i i420_pack_avx2(__m256i a, __m256i b)
+{
+	const auto ab = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+	return _mm_packus_epi16(_mm256_castsi256_si128(ab), _mm256_extracti128_si256(ab, 1));
+}
+
+///Convert the start of two rows to I420, 32 pixels at a time. Return the number of pixels
+///converted
+CPP_SDL2_TARGET("avx2")
+inline int i420_rows_avx2(
+	YuvWeights const& w,
+	Uint8 const*	  row0,
+	Uint8 const*	  row1,
+	Uint8*			  y0,
+	Uint8*			  y1,
+	Uint8*			  u,
+	Uint8*			  v,
+	int				  width)
+{
+	const auto wy = _mm256_broadcastsi128_si256(
+		_mm_load_si128(reinterpret_cast<__m128i const*>(w.y.data())));
+	const auto wu = _mm256_broadcastsi128_si256(
+		_mm_load_si128(reinterpret_cast<__m128i const*>(w.u.data())));
+	const auto wv = _mm256_broadcastsi128_si256(
+		_mm_load_si128(reinterpret_cast<__m128i const*>(w.v.data())));
+	const auto zero = _mm256_setzero_si256();
+
+	int x = 0;
+	for (; x + 32 <= width; x += 32)
+	{
+		__m256i luma0[4], luma1[4], blocks[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			const auto offset = (x + i * 8) * 4;
+			const auto p0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row0 + offset));
+			const auto p1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row1 + offset));
+
+			// Same as the SSE4.1 kernel, with pixels 0-3 in the low lane and 4-7 in the high one
+			const auto lo0 = _mm256_unpacklo_epi8(p0, zero), hi0 = _mm256_unpackhi_epi8(p0, zero);
+			const auto lo1 = _mm256_unpacklo_epi8(p1, zero), hi1 = _mm256_unpackhi_epi8(p1, zero);
+			luma0[i] = i420_luma_avx2(lo0, hi0, wy);
+			luma1[i] = i420_luma_avx2(lo1, hi1, wy);
+
+			const auto lo = _mm256_add_epi16(lo0, lo1), hi = _mm256_add_epi16(hi0, hi1);
+			blocks[i]
+				= _mm256_add_epi16(_mm256_unpacklo_epi64(lo, hi), _mm256_unpackhi_epi64(lo, hi));
+		}
+
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(y0 + x),
+			i420_pack_avx2(luma0[0], luma0[1], luma0[2], luma0[3]));
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(y1 + x),
+			i420_pack_avx2(luma1[0], luma1[1], luma1[2], luma1[3]));
+
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(u + x / 2),
+			i420_pack_avx2(
+				i420_chroma_avx2(blocks[0], blocks[1], wu),
+				i420_chroma_avx2(blocks[2], blocks[3], wu)));
+		_mm_storeu_si128(
+			reinterpret_cast<__m128i*>(v + x / 2),
+			i420_pack_avx2(
+				i420_chroma_avx2(blocks[0], blocks[1], wv),
+				i420_chroma_avx2(blocks[2], blocks[3], wv)));
+	}
+	return x;
+}
+#endif
+
+///Convert two rows of 4 byte pixels to I420 with the kernel matching the running CPU. For the
+///last row of odd heights, pass the same row twice and a null y1
+inline void i420_rows(
+	YuvWeights const& w,
+	Uint8 const*	  row0,
+	Uint8 const*	  row1,
+	Uint8*			  y0,
+	Uint8*			  y1,
+	Uint8*			  u,
+	Uint8*			  v,
+	int				  width)
+{
+	int x = 0;
+#ifdef CPP_SDL2_X86_DISPATCH
+	if (y1)
+	{
+		switch (simd_level())
+		{
+		case SimdLevel::avx2: x = i420_rows_avx2(w, row0, row1, y0, y1, u, v, width); break;
+		case SimdLevel::sse41: x = i420_rows_sse41(w, row0, row1, y0, y1, u, v, width); break;
+		case SimdLevel::scalar: break;
+		}
+	}
+#endif
+	i420_rows_scalar(w, row0, row1, y0, y1, u, v, x, width);
+}
+} // namespace details
+
+///\brief Convert a block of pixels to planar I420 (YUV 4:2:0), with BT.601 limited range colors.
+///
+///Chroma planes are (width + 1) / 2 by (height + 1) / 2, each sample being the average of a 2x2
+///block of pixels. 32 bit RGB formats (see has_fast_conversion()) are converted directly with SIMD
+///code, others are converted to ARGB8888 two rows at a time first.
+inline void convert_to_i420(
+	int			width,
+	int			height,
+	Uint32		format,
+	void const* pixels,
+	int			pitch,
+	Uint8*		y,
+	int			y_pitch,
+	Uint8*		u,
+	int			u_pitch,
+	Uint8*		v,
+	int			v_pitch)
+{
+	auto layout = details::byte_layout(format);
+
+	// Other formats go through a two row buffer
+	std::vector<Uint8> rows;
+	if (layout.bytes != 4)
+	{
+		layout = details::byte_layout(SDL_PIXELFORMAT_ARGB8888);
+		rows.resize(size_t(width) * 8);
+	}
+	const auto weights = details::make_yuv_weights(layout);
+
+	auto src = static_cast<Uint8 const*>(pixels);
+	for (int row = 0; row < height; row += 2)
+	{
+		const auto pair = row + 1 < height;
+		auto	   row0 = src + std::ptrdiff_t(row) * pitch;
+		auto	   row1 = pair ? row0 + pitch : row0;
+		if (!rows.empty())
+		{
+			convert_pixels(
+				width,
+				pair ? 2 : 1,
+				format,
+				row0,
+				pitch,
+				SDL_PIXELFORMAT_ARGB8888,
+				rows.data(),
+				width * 4);
+			row0 = rows.data();
+			row1 = pair ? row0 + width * 4 : row0;
+		}
+
+		auto y0 = y + std::ptrdiff_t(row) * y_pitch;
+		details::i420_rows(
+			weights,
+			row0,
+			row1,
+			y0,
+			pair ? y0 + y_pitch : nullptr,
+			u + std::ptrdiff_t(row / 2) * u_pitch,
+			v + std::ptrdiff_t(row / 2) * v_pitch,
+			width);
+	}
+}
+
+///\brief Image stored as planar I420 (YUV 4:2:0): a full size Y plane, then quarter size U and V
+///planes.
+///
+///The three planes are contiguous and unpadded, in the layout raw .yuv and .y4m files use, so the
+///whole image can be written with one call on data().
+class I420Image
+{
+public:
+	///Empty image
+	I420Image() = default;
+
+	///Create an image of the given size. Its pixels are zero
+	I420Image(int width, int height) { resize(width, height); }
+
+	///Create an image holding the pixels of a surface, converted
+	explicit I420Image(Surface const& surface) { assign(surface); }
+
+	///Change the size of the image. Its pixels are left unspecified
+	void resize(int width, int height)
+	{
+		width_	= width > 0 ? width : 0;
+		height_ = height > 0 ? height : 0;
+		data_.resize(size_t(width_) * height_ + 2 * size_t(uv_width()) * uv_height());
+	}
+
+	///Convert a block of pixels into this image, resizing it to match
+	void assign(int width, int height, Uint32 format, void const* pixels, int pitch)
+	{
+		resize(width, height);
+		convert_to_i420(
+			width_,
+			height_,
+			format,
+			pixels,
+			pitch,
+			y(),
+			y_pitch(),
+			u(),
+			uv_pitch(),
+			v(),
+			uv_pitch());
+	}
+
+	///Convert the pixels of a surface into this image, resizing it to match
+	void assign(Surface const& surface)
+	{
+		auto s = surface.ptr();
+		details::ScopedSurfaceLock lock{s};
+		assign(s->w, s->h, s->format->format, s->pixels, s->pitch);
+	}
+
+	///Get the width of the image
+	int width() const { return width_; }
+	///Get the height of the image
+	int height() const { return height_; }
+	///Get the size of the image
+	Vec2i size() const { return {width_, height_}; }
+
+	///Get the width of the U and V planes
+	int uv_width() const { return (width_ + 1) / 2; }
+	///Get the height of the U and V planes
+	int uv_height() const { return (height_ + 1) / 2; }
+
+	///Get the number of bytes between two rows of the Y plane
+	int y_pitch() const { return width_; }
+	///Get the number of bytes between two rows of the U and V planes
+	int uv_pitch() const { return uv_width(); }
+
+	///Get the Y plane
+	Uint8* y() { return data_.data(); }
+	///Get the Y plane
+	Uint8 const* y() const { return data_.data(); }
+	///Get the U plane
+	Uint8* u() { return y() + size_t(width_) * height_; }
+	///Get the U plane
+	Uint8 const* u() const { return y() + size_t(width_) * height_; }
+	///Get the V plane
+	Uint8* v() { return u() + size_t(uv_width()) * uv_height(); }
+	///Get the V plane
+	Uint8 const* v() const { return u() + size_t(uv_width()) * uv_height(); }
+
+	///Get the three planes, one after the other
+	Uint8 const* data() const { return data_.data(); }
+	///Get the size of the three planes, in bytes
+	size_t bytes() const { return data_.size(); }
+
+private:
+	int				   width_  = 0;
+	int				   height_ = 0;
+	std::vector<Uint8> data_;
+};
+
+} // namespace sdl